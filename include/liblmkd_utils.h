@@ -106,6 +106,14 @@ enum get_kill_count_err_result {
  */
 int lmkd_get_kill_count(int sock, struct lmk_getkillcnt* params);
 
+/*
+ * Get the number of kills LMKD has performed per kill reason, see LMK_KILLHIST_MAX_BUCKETS for
+ * the bucket layout. counts should have room for max_buckets values.
+ * On success returns number of buckets stored into counts.
+ * On error, get_kill_count_err_result integer value.
+ */
+int lmkd_get_kill_hist(int sock, uint64_t* counts, int max_buckets);
+
 __END_DECLS
 
 #endif /* _LIBLMKD_UTILS_H_ */
@@ -18,6 +18,7 @@
 #define _LMKD_H_
 
 #include <arpa/inet.h>
+#include <stdint.h>
 #include <sys/cdefs.h>
 #include <sys/types.h>
 
@@ -39,6 +40,7 @@ enum lmk_cmd {
     LMK_START_MONITORING,   /* Start psi monitoring if it was skipped earlier */
     LMK_BOOT_COMPLETED,     /* Notify LMKD boot is completed */
     LMK_PROCS_PRIO,         /* Register processes and set the same oom_adj_score */
+    LMK_GETKILLHIST,        /* Get number of kills per kill reason */
 };
 
 /*
@@ -210,6 +212,59 @@ static inline size_t lmkd_pack_set_getkillcnt_repl(LMKD_CTRL_PACKET packet, int
     return 2 * sizeof(int);
 }
 
+/*
+ * Kill reason buckets in LMK_GETKILLHIST reply. Bucket 0 counts kills without a reason, bucket
+ * N + 1 counts kills with kill reason N and the last bucket counts all vendor kill reasons.
+ * Replies carry the number of buckets, so clients should accept up to LMK_KILLHIST_MAX_BUCKETS.
+ */
+#define LMK_KILLHIST_MAX_BUCKETS 16
+
+/*
+ * LMK_GETKILLHIST reply is larger than other packets: command, bucket count and a 64-bit count
+ * per bucket sent as high and low 32-bit halves.
+ */
+#define LMK_KILLHIST_REPLY_MAX_SIZE (sizeof(int) * (2 + 2 * LMK_KILLHIST_MAX_BUCKETS))
+
+typedef int LMKD_KILLHIST_PACKET[LMK_KILLHIST_REPLY_MAX_SIZE / sizeof(int)];
+
+/*
+ * Prepare LMK_GETKILLHIST packet and return packet size in bytes.
+ * Warning: no checks performed, caller should ensure valid parameters.
+ */
+static inline size_t lmkd_pack_set_getkillhist(LMKD_CTRL_PACKET packet) {
+    packet[0] = htonl(LMK_GETKILLHIST);
+    return sizeof(int);
+}
+
+/*
+ * Prepare LMK_GETKILLHIST reply packet and return packet size in bytes.
+ * Warning: no checks performed, caller should ensure valid parameters.
+ */
+static inline size_t lmkd_pack_set_getkillhist_repl(LMKD_KILLHIST_PACKET packet,
+                                                    const uint64_t* counts, int bucket_cnt) {
+    packet[0] = htonl(LMK_GETKILLHIST);
+    packet[1] = htonl(bucket_cnt);
+    for (int i = 0; i < bucket_cnt; i++) {
+        packet[2 + 2 * i] = htonl((uint32_t)(counts[i] >> 32));
+        packet[3 + 2 * i] = htonl((uint32_t)counts[i]);
+    }
+    return (2 + 2 * bucket_cnt) * sizeof(int);
+}
+
+/*
+ * For LMK_GETKILLHIST reply get its payload and return the number of buckets.
+ * Warning: no checks performed, caller should ensure valid parameters.
+ */
+static inline int lmkd_pack_get_getkillhist_repl(LMKD_KILLHIST_PACKET packet, uint64_t* counts) {
+    int bucket_cnt = ntohl(packet[1]);
+
+    for (int i = 0; i < bucket_cnt; i++) {
+        counts[i] = ((uint64_t)(uint32_t)ntohl(packet[2 + 2 * i]) << 32) |
+                    (uint32_t)ntohl(packet[3 + 2 * i]);
+    }
+    return bucket_cnt;
+}
+
 /* Types of asynchronous events sent from lmkd to its clients */
 enum async_event_type {
     LMK_ASYNC_EVENT_FIRST,
@@ -150,6 +150,34 @@ int lmkd_get_kill_count(int sock, struct lmk_getkillcnt* params) {
     return packet[1];
 }
 
+int lmkd_get_kill_hist(int sock, uint64_t* counts, int max_buckets) {
+    LMKD_CTRL_PACKET packet;
+    LMKD_KILLHIST_PACKET reply;
+    int size;
+    int bucket_cnt;
+
+    size = lmkd_pack_set_getkillhist(packet);
+    if (TEMP_FAILURE_RETRY(write(sock, packet, size)) < 0) {
+        return (int)GET_KILL_COUNT_SEND_ERR;
+    }
+
+    size = TEMP_FAILURE_RETRY(read(sock, reply, LMK_KILLHIST_REPLY_MAX_SIZE));
+    if (size < 0) {
+        return (int)GET_KILL_COUNT_RECV_ERR;
+    }
+
+    if (size < 2 * (int)sizeof(int) || lmkd_pack_get_cmd(reply) != LMK_GETKILLHIST) {
+        return (int)GET_KILL_COUNT_FORMAT_ERR;
+    }
+    bucket_cnt = ntohl(reply[1]);
+    if (bucket_cnt < 0 || bucket_cnt > LMK_KILLHIST_MAX_BUCKETS ||
+        size != (2 + 2 * bucket_cnt) * (int)sizeof(int) || bucket_cnt > max_buckets) {
+        return (int)GET_KILL_COUNT_FORMAT_ERR;
+    }
+
+    return lmkd_pack_get_getkillhist_repl(reply, counts);
+}
+
 int create_memcg(uid_t uid, pid_t pid) {
     return createProcessGroup(uid, pid, true) == 0 ? 0 : -1;
 }
@@ -19,6 +19,7 @@
 
 #include <sys/cdefs.h>
 #include <sys/types.h>
+#include <time.h>
 
 __BEGIN_DECLS
 
@@ -91,6 +92,33 @@ void destroy_psi_monitor(int fd);
  */
 int parse_psi_line(char *line, enum psi_stall_type stall_type, struct psi_stats stats[]);
 
+/*
+ * Stall rate of a psi resource computed from the growth of the total stall time over a window,
+ * which reacts to stalls much faster than the kernel's 10 second average.
+ */
+struct psi_stall_rate {
+    int window_ms;
+    int sampled;
+    unsigned long window_total;
+    struct timespec window_start_tm;
+    struct timespec prev_sample_tm;
+    float stall_pct;
+};
+
+/*
+ * Initializes stall rate tracking over windows of at least window_ms.
+ */
+void psi_stall_rate_init(struct psi_stall_rate *rate, int window_ms);
+
+/*
+ * Updates stall rate with the total stall time in microseconds sampled at time tm, which is
+ * expected to be monotonic. Returns the stall time during the last complete window as a
+ * percentage of the window duration, comparable with the avg fields, or -1 if no complete window
+ * is available. Windows are restarted when samples are taken less often than once per window_ms.
+ */
+float psi_stall_rate_update(struct psi_stall_rate *rate, unsigned long total,
+                            const struct timespec *tm);
+
 __END_DECLS
 
 #endif  // __ANDROID_PSI_H__
@@ -18,6 +18,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/epoll.h>
@@ -106,16 +107,95 @@ void destroy_psi_monitor(int fd) {
     }
 }
 
+/*
+ * Parses " <name>=<value>" where value is a decimal number with an optional fraction.
+ * Returns the position following the value or NULL on mismatch.
+ */
+static const char* parse_psi_field(const char* str, const char* name, size_t name_len,
+                                   uint64_t* int_part, uint64_t* frac, uint64_t* frac_scale) {
+    if (*str++ != ' ' || strncmp(str, name, name_len) || str[name_len] != '=') {
+        return NULL;
+    }
+    str += name_len + 1;
+
+    if ((unsigned char)(*str - '0') > 9) {
+        return NULL;
+    }
+    /* wraps around like the kernel counter does when it does not fit into unsigned long */
+    for (*int_part = 0; (unsigned char)(*str - '0') <= 9; str++) {
+        *int_part = *int_part * 10 + (*str - '0');
+    }
+    *frac = 0;
+    *frac_scale = 1;
+    if (*str == '.') {
+        for (str++; (unsigned char)(*str - '0') <= 9; str++) {
+            if (*frac_scale < 1000000) {
+                *frac = *frac * 10 + (*str - '0');
+                *frac_scale *= 10;
+            }
+        }
+    }
+    return str;
+}
+
+static const char* parse_psi_avg(const char* str, const char* name, size_t name_len, float* avg) {
+    uint64_t int_part, frac, frac_scale;
+
+    if ((str = parse_psi_field(str, name, name_len, &int_part, &frac, &frac_scale)) != NULL) {
+        *avg = (float)((double)(int_part * frac_scale + frac) / (double)frac_scale);
+    }
+    return str;
+}
+
 int parse_psi_line(char *line, enum psi_stall_type stall_type, struct psi_stats stats[]) {
-    char type_name[5];
     struct psi_stats *stat = &stats[stall_type];
+    const char* pos = line;
+    uint64_t total, frac, frac_scale;
 
-    if (!line || sscanf(line, "%4s avg10=%f avg60=%f avg300=%f total=%lu",
-        type_name, &stat->avg10, &stat->avg60, &stat->avg300, &stat->total) != 5) {
+    /* "<type> avg10=<avg> avg60=<avg> avg300=<avg> total=<total>" */
+    if (!pos || strncmp(pos, stall_type_name[stall_type], 4)) {
         return -1;
     }
-    if (strcmp(type_name, stall_type_name[stall_type])) {
+    pos += 4;
+    if (!(pos = parse_psi_avg(pos, "avg10", 5, &stat->avg10)) ||
+        !(pos = parse_psi_avg(pos, "avg60", 5, &stat->avg60)) ||
+        !(pos = parse_psi_avg(pos, "avg300", 6, &stat->avg300)) ||
+        !(pos = parse_psi_field(pos, "total", 5, &total, &frac, &frac_scale))) {
         return -1;
     }
+    stat->total = (unsigned long)total;
     return 0;
 }
+
+void psi_stall_rate_init(struct psi_stall_rate *rate, int window_ms) {
+    memset(rate, 0, sizeof(*rate));
+    rate->window_ms = window_ms;
+    rate->stall_pct = -1;
+}
+
+static long psi_time_diff_ms(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000;
+}
+
+float psi_stall_rate_update(struct psi_stall_rate *rate, unsigned long total,
+                            const struct timespec *tm) {
+    long elapsed_ms;
+
+    if (!rate->sampled || psi_time_diff_ms(&rate->prev_sample_tm, tm) > rate->window_ms) {
+        /* first sample or samples are too sparse to cover the window, start a new one */
+        rate->window_total = total;
+        rate->window_start_tm = *tm;
+        rate->stall_pct = -1;
+    } else if ((elapsed_ms = psi_time_diff_ms(&rate->window_start_tm, tm)) >= rate->window_ms) {
+        /* unsigned arithmetic handles the counter wrapping around */
+        unsigned long stall_us = total - rate->window_total;
+
+        rate->stall_pct = (float)stall_us / (float)(elapsed_ms * 10);
+        rate->window_total = total;
+        rate->window_start_tm = *tm;
+    }
+    rate->prev_sample_tm = *tm;
+    rate->sampled = 1;
+
+    return rate->stall_pct;
+}
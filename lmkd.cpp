@@ -16,6 +16,7 @@
 
 #define LOG_TAG "lowmemorykiller"
 
+#include <dirent.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <pwd.h>
@@ -37,7 +38,7 @@
 #include <algorithm>
 #include <array>
 #include <memory>
-#include <shared_mutex>
+#include <mutex>
 #include <vector>
 
 #include <BpfSyscallWrappers.h>
@@ -56,8 +57,16 @@
 #include <processgroup/processgroup.h>
 #include <psi/psi.h>
 
+#include "name_arena.h"
+#include "pid_table.h"
+#include "proc_sampler.h"
+#include "procfs_fields.h"
+#include "procfs_scan.h"
+#include "procfs_source.h"
 #include "reaper.h"
+#include "registrants.h"
 #include "statslog.h"
+#include "telemetry.h"
 #include "watchdog.h"
 
 /*
@@ -77,10 +86,15 @@ static inline void trace_kill_end() {
     ATRACE_END();
 }
 
+static inline void trace_kill_latency(long latency_ms) {
+    ATRACE_INT("lmkd_kill_latency_ms", latency_ms);
+}
+
 #else /* LMKD_TRACE_KILLS */
 
 static inline void trace_kill_start(const char *) {}
 static inline void trace_kill_end() {}
+static inline void trace_kill_latency(long) {}
 
 #endif /* LMKD_TRACE_KILLS */
 
@@ -95,6 +109,9 @@ static inline void trace_kill_end() {}
 #define PROC_STATUS_RSS_FIELD "VmRSS:"
 #define PROC_STATUS_SWAP_FIELD "VmSwap:"
 #define NODE_STATS_MARKER "  per-node stats"
+#define NODE_SYSFS_DIR "/sys/devices/system/node"
+#define NODE_MEMINFO_PATH_FMT NODE_SYSFS_DIR "/node%d/meminfo"
+#define NODE_MEMINFO_FREE_FIELD "MemFree:"
 
 #define PERCEPTIBLE_APP_ADJ 200
 #define PREVIOUS_APP_ADJ 700
@@ -113,6 +130,7 @@ static inline void trace_kill_end() {}
 
 #define NS_PER_MS (NS_PER_SEC / MS_PER_SEC)
 #define US_PER_MS (US_PER_SEC / MS_PER_SEC)
+#define NS_PER_US (NS_PER_SEC / US_PER_SEC)
 
 /* Defined as ProcessList.SYSTEM_ADJ in ProcessList.java */
 #define SYSTEM_ADJ (-900)
@@ -168,8 +186,23 @@ static inline void trace_kill_end() {}
 #define DEF_SWAP_COMP_RATIO 1
 /* ro.lmk.lowmem_min_oom_score defaults */
 #define DEF_LOWMEM_MIN_SCORE (PREVIOUS_APP_ADJ + 1)
+/* ro.lmk.stall_window_ms property defaults */
+#define DEF_STALL_WINDOW_MS 0
+/* ro.lmk.proc_pool_size property defaults */
+#define DEF_PROC_POOL_SIZE 1024
+#define PROC_POOL_MIN_SIZE 64
+/* ro.lmk.proc_sample_interval_ms property defaults */
+#define DEF_PROC_SAMPLE_INTERVAL_MS 0
+/* sampling interval used when ro.lmk.kill_signal_first is set without one */
+#define SIGNAL_FIRST_SAMPLE_INTERVAL_MS 1000
+/* sampled sizes older than this many sampling intervals are not trusted */
+#define PROC_SAMPLE_MAX_AGE_INTERVALS 3
+/* max samples handled in a single wakeup of the main thread */
+#define PROC_SAMPLE_MAX_PER_WAKEUP 4096
 
 #define LMKD_REINIT_PROP "lmkd.reinit"
+/* directory of captured system files to read instead of the real ones, debuggable builds only */
+#define LMKD_FS_ROOT_PROP "lmkd.debug.fs_root"
 
 #define WATCHDOG_TIMEOUT_SEC 2
 
@@ -209,8 +242,27 @@ static struct timespec kswapd_start_tm;
 static int level_oomadj[VMPRESS_LEVEL_COUNT];
 static int mpevfd[VMPRESS_LEVEL_COUNT] = { -1, -1, -1 };
 static bool pidfd_supported;
-static int last_kill_pid_or_fd = -1;
+
+/* Max number of killed processes waited for at once */
+#define MAX_KILL_WAIT 16
+
+/*
+ * In-flight kills: killed processes lmkd waits for to die. Each pidfd is registered in epoll on its
+ * own, polling is paused while any kill is in flight. Unused entries have pid 0.
+ */
+struct kill_wait {
+    int pid;
+    int pid_or_fd; /* pidfd if pidfds are supported, pid otherwise */
+    /* when waiting for the kill started, used to time it out and to report its latency */
+    struct timespec start_tm;
+    /* pages expected to be freed by the kill */
+    int pages;
+};
+static struct kill_wait kill_waits[MAX_KILL_WAIT];
+static int kill_wait_cnt;
 static struct timespec last_kill_tm;
+/* when the current event handler started, used to report event-to-signal latency */
+static struct timespec handler_start_tm;
 enum vmpressure_level prev_level = VMPRESS_LEVEL_LOW;
 static bool monitors_initialized;
 static bool boot_completed_handled = false;
@@ -223,6 +275,9 @@ static int64_t upgrade_pressure;
 static int64_t downgrade_pressure;
 static bool low_ram_device;
 static bool kill_heaviest_task;
+static bool kill_signal_first;
+static bool kill_uid_group;
+static int kill_plan_max_victims;
 static unsigned long kill_timeout_ms;
 static int pressure_after_kill_min_score;
 static bool use_minfree_levels;
@@ -236,12 +291,22 @@ static int thrashing_critical_pct;
 static int swap_util_max;
 static int64_t filecache_min_kb;
 static int64_t stall_limit_critical;
+static int stall_window_ms;
+/* complete memory stall rate, used instead of avg10 when stall_window_ms is set */
+static struct psi_stall_rate mem_full_stall_rate;
 static bool use_psi_monitors = false;
 static int kpoll_fd;
 static bool delay_monitors_until_boot;
 static int direct_reclaim_threshold_ms;
 static int swap_compression_ratio;
 static int lowmem_min_oom_score;
+static bool per_node_watermarks;
+static int proc_pool_chunk_size;
+static int proc_sample_interval_ms;
+/* when the sampler last completed sampling all registered processes */
+static struct timespec last_sample_round_tm;
+/* generation of the last created process record */
+static uint32_t proc_gen;
 static struct psi_threshold psi_thresholds[VMPRESS_LEVEL_COUNT] = {
     { PSI_SOME, 70 },    /* 70ms out of 1sec for partial stall */
     { PSI_SOME, 100 },   /* 100ms out of 1sec for partial stall */
@@ -250,9 +315,16 @@ static struct psi_threshold psi_thresholds[VMPRESS_LEVEL_COUNT] = {
 
 static uint64_t mp_event_count;
 
+/* used only by the telemetry thread, or by the main thread when telemetry is disabled */
 static android_log_context ctx;
+/* kill reports from the watchdog thread use their own context */
+static android_log_context watchdog_ctx;
 static Reaper reaper;
 static int reaper_comm_fd[2];
+/* samples of process sizes from the sampler thread */
+static int sampler_comm_fd[2];
+/* pids of processes killed by the watchdog thread */
+static int watchdog_comm_fd[2];
 
 enum polling_update {
     POLLING_DO_NOT_CHANGE,
@@ -297,15 +369,24 @@ struct sock_event_handler_info {
 static struct sock_event_handler_info ctrl_sock;
 static struct sock_event_handler_info data_sock[MAX_DATA_CONN];
 
+/*
+ * Process records per registrant. Registrants are the connected clients, a registrant which
+ * finds no free entry keeps its records in the unclaimed list. Used only from the main thread.
+ */
+static Registrants registrants(MAX_DATA_CONN);
+
 /* vmpressure event handler data */
 static struct event_handler_info vmpressure_hinfo[VMPRESS_LEVEL_COUNT];
 
 /*
  * 1 ctrl listen socket, 3 ctrl data socket, 3 memory pressure levels,
- * 1 lmk events + 1 fd to wait for process death + 1 fd to receive kill failure notifications
- * + 1 fd to receive memevent_listener notifications
+ * 1 lmk events + MAX_KILL_WAIT fds to wait for process deaths
+ * + 1 fd to receive kill failure notifications
+ * + 1 fd to receive memevent_listener notifications + 1 fd to receive process size samples
+ * + 1 fd to receive watchdog kill notifications
  */
-#define MAX_EPOLL_EVENTS (1 + MAX_DATA_CONN + VMPRESS_LEVEL_COUNT + 1 + 1 + 1 + 1)
+#define MAX_EPOLL_EVENTS \
+    (1 + MAX_DATA_CONN + VMPRESS_LEVEL_COUNT + 1 + MAX_KILL_WAIT + 1 + 1 + 1 + 1)
 static int epollfd;
 static int maxevents;
 
@@ -329,7 +410,7 @@ enum zoneinfo_zone_field {
     ZI_ZONE_FIELD_COUNT
 };
 
-static const char* const zoneinfo_zone_field_names[ZI_ZONE_FIELD_COUNT] = {
+static constexpr const char* zoneinfo_zone_field_names[ZI_ZONE_FIELD_COUNT] = {
     "nr_free_pages",
     "min",
     "low",
@@ -338,6 +419,8 @@ static const char* const zoneinfo_zone_field_names[ZI_ZONE_FIELD_COUNT] = {
     "nr_free_cma",
 };
 
+static constexpr field_index<ZI_ZONE_FIELD_COUNT> zoneinfo_zone_field_index(zoneinfo_zone_field_names);
+
 /* zoneinfo per-zone special fields */
 enum zoneinfo_zone_spec_field {
     ZI_ZONE_SPEC_PROTECTION = 0,
@@ -345,11 +428,13 @@ enum zoneinfo_zone_spec_field {
     ZI_ZONE_SPEC_FIELD_COUNT,
 };
 
-static const char* const zoneinfo_zone_spec_field_names[ZI_ZONE_SPEC_FIELD_COUNT] = {
+static constexpr const char* zoneinfo_zone_spec_field_names[ZI_ZONE_SPEC_FIELD_COUNT] = {
     "protection:",
     "pagesets",
 };
 
+static constexpr field_index<ZI_ZONE_SPEC_FIELD_COUNT> zoneinfo_zone_spec_field_index(zoneinfo_zone_spec_field_names);
+
 /* see __MAX_NR_ZONES definition in kernel mmzone.h */
 #define MAX_NR_ZONES 6
 
@@ -378,11 +463,13 @@ enum zoneinfo_node_field {
     ZI_NODE_FIELD_COUNT
 };
 
-static const char* const zoneinfo_node_field_names[ZI_NODE_FIELD_COUNT] = {
+static constexpr const char* zoneinfo_node_field_names[ZI_NODE_FIELD_COUNT] = {
     "nr_inactive_file",
     "nr_active_file",
 };
 
+static constexpr field_index<ZI_NODE_FIELD_COUNT> zoneinfo_node_field_index(zoneinfo_node_field_names);
+
 union zoneinfo_node_fields {
     struct {
         int64_t nr_inactive_file;
@@ -398,133 +485,15 @@ struct zoneinfo_node {
     union zoneinfo_node_fields fields;
 };
 
-/* for now two memory nodes is more than enough */
-#define MAX_NR_NODES 2
-
 struct zoneinfo {
     int node_count;
-    struct zoneinfo_node nodes[MAX_NR_NODES];
+    /* grows to the number of nodes on the first parse, entries past node_count are unused */
+    std::vector<struct zoneinfo_node> nodes;
     int64_t totalreserve_pages;
     int64_t total_inactive_file;
     int64_t total_active_file;
 };
 
-/* Fields to parse in /proc/meminfo */
-enum meminfo_field {
-    MI_NR_FREE_PAGES = 0,
-    MI_CACHED,
-    MI_SWAP_CACHED,
-    MI_BUFFERS,
-    MI_SHMEM,
-    MI_UNEVICTABLE,
-    MI_TOTAL_SWAP,
-    MI_FREE_SWAP,
-    MI_ACTIVE_ANON,
-    MI_INACTIVE_ANON,
-    MI_ACTIVE_FILE,
-    MI_INACTIVE_FILE,
-    MI_SRECLAIMABLE,
-    MI_SUNRECLAIM,
-    MI_KERNEL_STACK,
-    MI_PAGE_TABLES,
-    MI_ION_HELP,
-    MI_ION_HELP_POOL,
-    MI_CMA_FREE,
-    MI_FIELD_COUNT
-};
-
-static const char* const meminfo_field_names[MI_FIELD_COUNT] = {
-    "MemFree:",
-    "Cached:",
-    "SwapCached:",
-    "Buffers:",
-    "Shmem:",
-    "Unevictable:",
-    "SwapTotal:",
-    "SwapFree:",
-    "Active(anon):",
-    "Inactive(anon):",
-    "Active(file):",
-    "Inactive(file):",
-    "SReclaimable:",
-    "SUnreclaim:",
-    "KernelStack:",
-    "PageTables:",
-    "ION_heap:",
-    "ION_heap_pool:",
-    "CmaFree:",
-};
-
-union meminfo {
-    struct {
-        int64_t nr_free_pages;
-        int64_t cached;
-        int64_t swap_cached;
-        int64_t buffers;
-        int64_t shmem;
-        int64_t unevictable;
-        int64_t total_swap;
-        int64_t free_swap;
-        int64_t active_anon;
-        int64_t inactive_anon;
-        int64_t active_file;
-        int64_t inactive_file;
-        int64_t sreclaimable;
-        int64_t sunreclaimable;
-        int64_t kernel_stack;
-        int64_t page_tables;
-        int64_t ion_heap;
-        int64_t ion_heap_pool;
-        int64_t cma_free;
-        /* fields below are calculated rather than read from the file */
-        int64_t nr_file_pages;
-        int64_t total_gpu_kb;
-        int64_t easy_available;
-    } field;
-    int64_t arr[MI_FIELD_COUNT];
-};
-
-/* Fields to parse in /proc/vmstat */
-enum vmstat_field {
-    VS_FREE_PAGES,
-    VS_INACTIVE_FILE,
-    VS_ACTIVE_FILE,
-    VS_WORKINGSET_REFAULT,
-    VS_WORKINGSET_REFAULT_FILE,
-    VS_PGSCAN_KSWAPD,
-    VS_PGSCAN_DIRECT,
-    VS_PGSCAN_DIRECT_THROTTLE,
-    VS_PGREFILL,
-    VS_FIELD_COUNT
-};
-
-static const char* const vmstat_field_names[VS_FIELD_COUNT] = {
-    "nr_free_pages",
-    "nr_inactive_file",
-    "nr_active_file",
-    "workingset_refault",
-    "workingset_refault_file",
-    "pgscan_kswapd",
-    "pgscan_direct",
-    "pgscan_direct_throttle",
-    "pgrefill",
-};
-
-union vmstat {
-    struct {
-        int64_t nr_free_pages;
-        int64_t nr_inactive_file;
-        int64_t nr_active_file;
-        int64_t workingset_refault;
-        int64_t workingset_refault_file;
-        int64_t pgscan_kswapd;
-        int64_t pgscan_direct;
-        int64_t pgscan_direct_throttle;
-        int64_t pgrefill;
-    } field;
-    int64_t arr[VS_FIELD_COUNT];
-};
-
 enum field_match_result {
     NO_MATCH,
     PARSE_FAIL,
@@ -542,45 +511,93 @@ struct proc {
     int pidfd;
     uid_t uid;
     int oomadj;
-    pid_t reg_pid; /* PID of the process that registered this record */
     bool valid;
-    struct proc *pidhash_next;
+    /* tells samples of this record from samples of a previous record of the same pid */
+    uint32_t gen;
+    /* last size reported by the sampler in pages, -1 if not sampled yet */
+    int rss_pages;
+    int swap_pages;
+    struct timespec sample_tm;
+    /* position in the size ordered heap of its oomadj level, -1 if not in the heap */
+    int heap_idx;
+    /* link in the records of its registrant, reg.reg_pid is the PID that registered it */
+    Registrants::node reg;
+    /* link in the uidhash bucket of uid */
+    struct adjslot_list uid_list;
+    /* handle of the name cached in proc_names, INVALID_HANDLE if unknown or not cached */
+    int name;
 };
 
+/*
+ * Process names are kept in a compact arena for the kills which are reported without reading
+ * cmdline, see proc_cache_names(). Used only from the main thread.
+ */
+static NameArena proc_names(MAX_TASKNAME_LEN - 1);
+/* average name length used to preallocate the arena for a chunk of process records */
+#define PROC_NAME_AVG_LEN 48
+
+static const char *proc_cached_name(struct proc *procp) {
+    return proc_names.get(procp->name);
+}
+
 struct reread_data {
     const char* const filename;
     int fd;
+    /* read buffer owned by this file, see reread_data_prime() */
+    char *buf;
+    size_t buf_size;
 };
 
-#define PIDHASH_SZ 1024
-static struct proc *pidhash[PIDHASH_SZ];
-#define pid_hashfn(x) ((((x) >> 8) ^ (x)) & (PIDHASH_SZ - 1))
+/* Process records by pid, modified under the exclusive adjslot_list_lock */
+static PidTable<struct proc> pid_table;
 
 #define ADJTOSLOT(adj) ((adj) + -OOM_SCORE_ADJ_MIN)
 #define ADJTOSLOT_COUNT (ADJTOSLOT(OOM_SCORE_ADJ_MAX) + 1)
 
-// protects procadjslot_list from concurrent access
-static std::shared_mutex adjslot_list_lock;
-// procadjslot_list should be modified only from the main thread while exclusively holding
-// adjslot_list_lock. Readers from non-main threads should hold adjslot_list_lock shared lock.
+// procadjslot_list should be accessed only from the main thread. Other threads read the kill
+// candidates published by proc_snapshot_publish().
 static struct adjslot_list procadjslot_list[ADJTOSLOT_COUNT];
 
-#define MAX_DISTINCT_OOM_ADJ 32
-#define KILLCNT_INVALID_IDX 0xFF
 /*
- * Because killcnt array is sparse a two-level indirection is used
- * to keep the size small. killcnt_idx stores index of the element in
- * killcnt array. Index KILLCNT_INVALID_IDX indicates an unused slot.
+ * Two-level bitmap of oomadj slots. Bit i of words[w] is set for slot w * 64 + i and bit w of
+ * summary is set while words[w] is non-zero, so the next set slot is found with at most two
+ * find-last-set operations.
+ */
+#define ADJSLOT_BITMAP_WORDS ((ADJTOSLOT_COUNT + 63) / 64)
+static_assert(ADJSLOT_BITMAP_WORDS <= 64, "adjslot bitmap summary does not fit into 64 bits");
+
+struct adjslot_bitmap {
+    uint64_t summary;
+    uint64_t words[ADJSLOT_BITMAP_WORDS];
+};
+
+// Slots with processes, updated together with procadjslot_list.
+static struct adjslot_bitmap procadjslot_bitmap;
+// Incremented on every procadjslot_list change, the published snapshot carries the value it
+// was built at.
+static uint64_t procadjslot_gen;
+
+/*
+ * Kill counts per oomadj level are kept in a binary indexed (Fenwick) tree, so that counts over
+ * a range of levels are summed in O(log n). Element i covers the i & -i levels ending at slot
+ * i - 1, element 0 is unused.
  */
-static uint8_t killcnt_idx[ADJTOSLOT_COUNT];
-static uint16_t killcnt[MAX_DISTINCT_OOM_ADJ];
-static int killcnt_free_idx = 0;
-static uint32_t killcnt_total = 0;
+static uint64_t killcnt_tree[ADJTOSLOT_COUNT + 1];
+static uint64_t killcnt_total = 0;
+
+/* Kill counts per kill reason, see LMK_KILLHIST_MAX_BUCKETS for the bucket layout */
+#define KILLHIST_BUCKET_COUNT (AOSP_KILL_REASON_COUNT + 2)
+static_assert(KILLHIST_BUCKET_COUNT <= LMK_KILLHIST_MAX_BUCKETS,
+              "Kill reasons do not fit into LMK_GETKILLHIST reply");
+static uint64_t killhist[KILLHIST_BUCKET_COUNT];
 
 static int pagesize;
 static long page_k; /* page size in kB */
 
 static bool update_props();
+static bool is_waiting_for_fd(int fd);
+static struct proc *pid_lookup(int pid);
+static inline long get_time_diff_ms(struct timespec *from, struct timespec *to);
 static bool init_monitors();
 static void destroy_monitors();
 static bool init_memevent_listener_monitoring();
@@ -590,29 +607,14 @@ static int clamp(int low, int high, int value) {
 }
 
 static bool parse_int64(const char* str, int64_t* ret) {
-    char* endptr;
-    long long val = strtoll(str, &endptr, 10);
-    if (str == endptr || val > INT64_MAX) {
-        return false;
-    }
-    *ret = (int64_t)val;
-    return true;
-}
-
-static int find_field(const char* name, const char* const field_names[], int field_count) {
-    for (int i = 0; i < field_count; i++) {
-        if (!strcmp(name, field_names[i])) {
-            return i;
-        }
-    }
-    return -1;
+    return scan_int64(str, ret) != NULL;
 }
 
+template <int N>
 static enum field_match_result match_field(const char* cp, const char* ap,
-                                   const char* const field_names[],
-                                   int field_count, int64_t* field,
-                                   int *field_idx) {
-    int i = find_field(cp, field_names, field_count);
+                                           const field_index<N>& index, int64_t* field,
+                                           int *field_idx) {
+    int i = index.find(cp);
     if (i < 0) {
         return NO_MATCH;
     }
@@ -646,26 +648,57 @@ static ssize_t read_all(int fd, char *buf, size_t max_len)
     return ret;
 }
 
+/* Read buffers are sized during init to twice the file size */
+#define REREAD_BUF_HEADROOM 2
+
+/* Set once read buffers are primed during init, buffer growth after that gets reported */
+static bool reread_bufs_primed = false;
+static unsigned long reread_buf_grow_count = 0;
+
+/*
+ * Resizes the read buffer of the file and locks it in memory so that reading the file under
+ * memory pressure does not fault.
+ */
+static bool reread_buf_resize(struct reread_data *data, size_t size) {
+    char *new_buf;
+
+    if (data->buf) {
+        munlock(data->buf, data->buf_size);
+    }
+    if ((new_buf = static_cast<char*>(realloc(data->buf, size))) == nullptr) {
+        if (data->buf) {
+            mlock(data->buf, data->buf_size);
+        }
+        return false;
+    }
+    data->buf = new_buf;
+    data->buf_size = size;
+    /* CAP_IPC_LOCK required */
+    if (mlock(data->buf, data->buf_size)) {
+        ALOGW("%s buffer mlock failed: %s", data->filename, strerror(errno));
+    }
+    return true;
+}
+
 /*
  * Read a new or already opened file from the beginning.
  * If the file has not been opened yet data->fd should be set to -1.
  * To be used with files which are read often and possibly during high
  * memory pressure to minimize file opening which by itself requires kernel
  * memory allocation and might result in a stall on memory stressed system.
+ * Each file has its own buffer, so different files can be read concurrently. The returned
+ * buffer stays valid until the next read of the same file.
  */
 static char *reread_file(struct reread_data *data) {
-    /* start with page-size buffer and increase if needed */
-    static ssize_t buf_size = pagesize;
-    static char *new_buf, *buf = NULL;
     ssize_t size;
 
     if (data->fd == -1) {
-        /* First-time buffer initialization */
-        if (!buf && (buf = static_cast<char*>(malloc(buf_size))) == nullptr) {
+        /* First-time buffer initialization, start with page-size buffer and increase if needed */
+        if (!data->buf && !reread_buf_resize(data, pagesize)) {
             return NULL;
         }
 
-        data->fd = TEMP_FAILURE_RETRY(open(data->filename, O_RDONLY | O_CLOEXEC));
+        data->fd = procfs_open(data->filename, O_RDONLY | O_CLOEXEC);
         if (data->fd < 0) {
             ALOGE("%s open: %s", data->filename, strerror(errno));
             return NULL;
@@ -673,59 +706,86 @@ static char *reread_file(struct reread_data *data) {
     }
 
     while (true) {
-        size = read_all(data->fd, buf, buf_size - 1);
+        size = read_all(data->fd, data->buf, data->buf_size - 1);
         if (size < 0) {
             ALOGE("%s read: %s", data->filename, strerror(errno));
             close(data->fd);
             data->fd = -1;
             return NULL;
         }
-        if (size < buf_size - 1) {
+        if (size < (ssize_t)data->buf_size - 1) {
             break;
         }
         /*
          * Since we are reading /proc files we can't use fstat to find out
          * the real size of the file. Double the buffer size and keep retrying.
          */
-        if ((new_buf = static_cast<char*>(realloc(buf, buf_size * 2))) == nullptr) {
+        if (!reread_buf_resize(data, data->buf_size * 2)) {
             errno = ENOMEM;
             return NULL;
         }
-        buf = new_buf;
-        buf_size *= 2;
+        if (reread_bufs_primed) {
+            reread_buf_grow_count++;
+            ALOGW("%s buffer outgrown after init, resized to %zu bytes (%lu resizes)",
+                  data->filename, data->buf_size, reread_buf_grow_count);
+        }
     }
-    buf[size] = 0;
+    data->buf[size] = 0;
 
-    return buf;
+    return data->buf;
 }
 
-static bool claim_record(struct proc* procp, pid_t pid) {
-    if (procp->reg_pid == pid) {
-        /* Record already belongs to the registrant */
-        return true;
+/*
+ * Opens the file and allocates its read buffer with headroom for the file to grow, so that
+ * reading it later does not allocate. Files not supported by the kernel are skipped.
+ */
+static void reread_data_prime(struct reread_data *data) {
+    char *buf;
+    size_t size;
+
+    if (procfs_access(data->filename, R_OK)) {
+        return;
     }
-    if (procp->reg_pid == 0) {
-        /* Old registrant is gone, claim the record */
-        procp->reg_pid = pid;
-        return true;
+    if ((buf = reread_file(data)) == NULL) {
+        return;
+    }
+    size = (strlen(buf) + 1) * REREAD_BUF_HEADROOM;
+    size = (size + pagesize - 1) & ~((size_t)pagesize - 1);
+    if (size > data->buf_size && !reread_buf_resize(data, size)) {
+        ALOGE("%s buffer allocation failed", data->filename);
     }
-    /* The record is owned by another registrant */
-    return false;
 }
 
-static void remove_claims(pid_t pid) {
-    int i;
+/* Files read on memory pressure events, their buffers are primed during init */
+static struct reread_data zoneinfo_file_data = {
+    .filename = ZONEINFO_PATH,
+    .fd = -1,
+};
 
-    for (i = 0; i < PIDHASH_SZ; i++) {
-        struct proc* procp = pidhash[i];
-        while (procp) {
-            if (procp->reg_pid == pid) {
-                procp->reg_pid = 0;
-            }
-            procp = procp->pidhash_next;
-        }
-    }
-}
+static struct reread_data meminfo_file_data = {
+    .filename = MEMINFO_PATH,
+    .fd = -1,
+};
+
+static struct reread_data vmstat_file_data = {
+    .filename = VMSTAT_PATH,
+    .fd = -1,
+};
+
+static struct reread_data psi_file_data[PSI_RESOURCE_COUNT] = {
+    {
+        .filename = psi_resource_file[PSI_MEMORY],
+        .fd = -1,
+    },
+    {
+        .filename = psi_resource_file[PSI_IO],
+        .fd = -1,
+    },
+    {
+        .filename = psi_resource_file[PSI_CPU],
+        .fd = -1,
+    },
+};
 
 static void ctrl_data_close(int dsock_idx) {
     struct epoll_event epev;
@@ -741,7 +801,7 @@ static void ctrl_data_close(int dsock_idx) {
     data_sock[dsock_idx].sock = -1;
 
     /* Mark all records of the old registrant as unclaimed */
-    remove_claims(data_sock[dsock_idx].pid);
+    registrants.release(data_sock[dsock_idx].pid);
 }
 
 static ssize_t ctrl_data_read(int dsock_idx, char* buf, size_t bufsz, struct ucred* sender_cred) {
@@ -801,6 +861,18 @@ static int ctrl_data_write(int dsock_idx, char* buf, size_t bufsz) {
     return ret;
 }
 
+/*
+ * Write an asynchronous event to all clients subscribed to it. Can be called only from the main
+ * thread.
+ */
+static void ctrl_data_write_async_event(enum async_event_type evt_type, char* buf, size_t bufsz) {
+    for (int i = 0; i < MAX_DATA_CONN; i++) {
+        if (data_sock[i].sock >= 0 && data_sock[i].async_event_mask & 1 << evt_type) {
+            ctrl_data_write(i, buf, bufsz);
+        }
+    }
+}
+
 /*
  * Write the pid/uid pair over the data socket, note: all active clients
  * will receive this unsolicited notification.
@@ -809,11 +881,7 @@ static void ctrl_data_write_lmk_kill_occurred(pid_t pid, uid_t uid, int64_t rss_
     LMKD_CTRL_PACKET packet;
     size_t len = lmkd_pack_set_prockills(packet, pid, uid, static_cast<int>(rss_kb));
 
-    for (int i = 0; i < MAX_DATA_CONN; i++) {
-        if (data_sock[i].sock >= 0 && data_sock[i].async_event_mask & 1 << LMK_ASYNC_EVENT_KILL) {
-            ctrl_data_write(i, (char*)packet, len);
-        }
-    }
+    ctrl_data_write_async_event(LMK_ASYNC_EVENT_KILL, (char*)packet, len);
 }
 
 /*
@@ -827,17 +895,14 @@ static void stats_write_lmk_kill_occurred(struct kill_stat *kill_st,
         return;
     }
 
-    for (int i = 0; i < MAX_DATA_CONN; i++) {
-        if (data_sock[i].sock >= 0 && data_sock[i].async_event_mask & 1 << LMK_ASYNC_EVENT_STAT) {
-            ctrl_data_write(i, packet, len);
-        }
-    }
-
+    ctrl_data_write_async_event(LMK_ASYNC_EVENT_STAT, packet, len);
 }
 
 static void stats_write_lmk_kill_occurred_pid(int pid, struct kill_stat *kill_st,
                                               struct memory_stat *mem_st) {
-    kill_st->taskname = stats_get_task_name(pid);
+    struct proc *procp = pid_lookup(pid);
+
+    kill_st->taskname = procp ? proc_cached_name(procp) : NULL;
     if (kill_st->taskname != NULL) {
         stats_write_lmk_kill_occurred(kill_st, mem_st);
     }
@@ -906,14 +971,9 @@ static bool init_poll_kernel() {
     return true;
 }
 
+// Can be called only from the main thread.
 static struct proc *pid_lookup(int pid) {
-    struct proc *procp;
-
-    for (procp = pidhash[pid_hashfn(pid)]; procp && procp->pid != pid;
-         procp = procp->pidhash_next)
-            ;
-
-    return procp;
+    return pid_table.find(pid);
 }
 
 static void adjslot_insert(struct adjslot_list *head, struct adjslot_list *new_element)
@@ -939,190 +999,619 @@ static struct adjslot_list *adjslot_tail(struct adjslot_list *head) {
     return asl == head ? NULL : asl;
 }
 
-// Should be modified only from the main thread.
-static void proc_slot(struct proc *procp) {
-    int adjslot = ADJTOSLOT(procp->oomadj);
-    std::scoped_lock lock(adjslot_list_lock);
-
-    adjslot_insert(&procadjslot_list[adjslot], &procp->asl);
-}
-
-// Should be modified only from the main thread.
-static void proc_unslot(struct proc *procp) {
-    std::scoped_lock lock(adjslot_list_lock);
-
-    adjslot_remove(&procp->asl);
+static inline void adjslot_bitmap_set(struct adjslot_bitmap *bitmap, int slot) {
+    bitmap->words[slot / 64] |= 1ULL << (slot % 64);
+    bitmap->summary |= 1ULL << (slot / 64);
 }
 
-static void proc_insert(struct proc *procp) {
-    int hval = pid_hashfn(procp->pid);
-
-    procp->pidhash_next = pidhash[hval];
-    pidhash[hval] = procp;
-    proc_slot(procp);
+static inline void adjslot_bitmap_clear(struct adjslot_bitmap *bitmap, int slot) {
+    if ((bitmap->words[slot / 64] &= ~(1ULL << (slot % 64))) == 0) {
+        bitmap->summary &= ~(1ULL << (slot / 64));
+    }
 }
 
-// Can be called only from the main thread.
-static int pid_remove(int pid) {
-    int hval = pid_hashfn(pid);
-    struct proc *procp;
-    struct proc *prevp;
-
-    for (procp = pidhash[hval], prevp = NULL; procp && procp->pid != pid;
-         procp = procp->pidhash_next)
-            prevp = procp;
+/* Returns the highest set slot which is not above the given one or -1 if there is none */
+static int adjslot_bitmap_find_last(const struct adjslot_bitmap *bitmap, int slot) {
+    int word;
+    uint64_t bits;
 
-    if (!procp)
+    if (slot < 0) {
         return -1;
-
-    if (!prevp)
-        pidhash[hval] = procp->pidhash_next;
-    else
-        prevp->pidhash_next = procp->pidhash_next;
-
-    proc_unslot(procp);
-    /*
-     * Close pidfd here if we are not waiting for corresponding process to die,
-     * in which case stop_wait_for_proc_kill() will close the pidfd later
-     */
-    if (procp->pidfd >= 0 && procp->pidfd != last_kill_pid_or_fd) {
-        close(procp->pidfd);
     }
-    free(procp);
-    return 0;
+    word = slot / 64;
+    bits = bitmap->words[word] & (~0ULL >> (63 - slot % 64));
+    if (!bits) {
+        /* look for the highest non-empty word below */
+        bits = word ? bitmap->summary & (~0ULL >> (64 - word)) : 0;
+        if (!bits) {
+            return -1;
+        }
+        word = 63 - __builtin_clzll(bits);
+        bits = bitmap->words[word];
+    }
+    return word * 64 + 63 - __builtin_clzll(bits);
 }
 
-static void pid_invalidate(int pid) {
-    std::shared_lock lock(adjslot_list_lock);
-    struct proc *procp = pid_lookup(pid);
-
-    if (procp) {
-        procp->valid = false;
+/*
+ * Returns the highest oomadj level not above the given one which has processes or
+ * OOM_SCORE_ADJ_MIN - 1 if there is none.
+ * Can be called only from the main thread.
+ */
+static int proc_adj_prev_occupied(int oomadj) {
+    if (oomadj < OOM_SCORE_ADJ_MIN) {
+        return OOM_SCORE_ADJ_MIN - 1;
     }
+    return adjslot_bitmap_find_last(&procadjslot_bitmap,
+                                    ADJTOSLOT(std::min(oomadj, OOM_SCORE_ADJ_MAX))) +
+           OOM_SCORE_ADJ_MIN;
 }
 
 /*
- * Write a string to a file.
- * Returns false if the file does not exist.
+ * Besides the LRU list, processes at each oomadj level are kept in a max-heap keyed on the RSS
+ * reported by the sampler, so that the heaviest process at a level is found without visiting all
+ * of them. Processes not sampled yet have key -1 and sink to the bottom.
+ * Used only from the main thread.
  */
-static bool writefilestring(const char *path, const char *s,
-                            bool err_if_missing) {
-    int fd = open(path, O_WRONLY | O_CLOEXEC);
-    ssize_t len = strlen(s);
-    ssize_t ret;
-
-    if (fd < 0) {
-        if (err_if_missing) {
-            ALOGE("Error opening %s; errno=%d", path, errno);
-        }
-        return false;
-    }
+struct proc_heap {
+    struct proc **procs;
+    int count;
+    int capacity;
+    /* number of processes not sampled yet */
+    int unsampled;
+    /* a process could not be added, the heap is not trusted until it gets empty */
+    bool incomplete;
+};
 
-    ret = TEMP_FAILURE_RETRY(write(fd, s, len));
-    if (ret < 0) {
-        ALOGE("Error writing %s; errno=%d", path, errno);
-    } else if (ret < len) {
-        ALOGE("Short write on %s; length=%zd", path, ret);
-    }
+#define PROC_HEAP_MIN_SIZE 16
 
-    close(fd);
-    return true;
-}
+static struct proc_heap proc_heaps[ADJTOSLOT_COUNT];
 
-static inline long get_time_diff_ms(struct timespec *from,
-                                    struct timespec *to) {
-    return (to->tv_sec - from->tv_sec) * (long)MS_PER_SEC +
-           (to->tv_nsec - from->tv_nsec) / (long)NS_PER_MS;
+static inline void proc_heap_set(struct proc_heap *heap, int idx, struct proc *procp) {
+    heap->procs[idx] = procp;
+    procp->heap_idx = idx;
 }
 
-/* Reads /proc/pid/status into buf. */
-static bool read_proc_status(int pid, char *buf, size_t buf_sz) {
-    char path[PROCFS_PATH_MAX];
-    int fd;
-    ssize_t size;
+static void proc_heap_sift_up(struct proc_heap *heap, int idx) {
+    struct proc *procp = heap->procs[idx];
 
-    snprintf(path, PROCFS_PATH_MAX, "/proc/%d/status", pid);
-    fd = open(path, O_RDONLY | O_CLOEXEC);
-    if (fd < 0) {
-        return false;
-    }
+    while (idx > 0) {
+        int parent = (idx - 1) / 2;
 
-    size = read_all(fd, buf, buf_sz - 1);
-    close(fd);
-    if (size <= 0) {
-        return false;
+        if (heap->procs[parent]->rss_pages >= procp->rss_pages) {
+            break;
+        }
+        proc_heap_set(heap, idx, heap->procs[parent]);
+        idx = parent;
     }
-    buf[size] = 0;
-    return true;
+    proc_heap_set(heap, idx, procp);
 }
 
-/* Looks for tag in buf and parses the first integer */
-static bool parse_status_tag(char *buf, const char *tag, int64_t *out) {
-    char *pos = buf;
+static void proc_heap_sift_down(struct proc_heap *heap, int idx) {
+    struct proc *procp = heap->procs[idx];
+
     while (true) {
-        pos = strstr(pos, tag);
-        /* Stop if tag not found or found at the line beginning */
-        if (pos == NULL || pos == buf || pos[-1] == '\n') {
+        int child = 2 * idx + 1;
+
+        if (child >= heap->count) {
             break;
         }
-        pos++;
-    }
-
-    if (pos == NULL) {
-        return false;
+        if (child + 1 < heap->count &&
+            heap->procs[child + 1]->rss_pages > heap->procs[child]->rss_pages) {
+            child++;
+        }
+        if (heap->procs[child]->rss_pages <= procp->rss_pages) {
+            break;
+        }
+        proc_heap_set(heap, idx, heap->procs[child]);
+        idx = child;
     }
-
-    pos += strlen(tag);
-    while (*pos == ' ') ++pos;
-    return parse_int64(pos, out);
+    proc_heap_set(heap, idx, procp);
 }
 
-static int proc_get_size(int pid) {
-    char path[PROCFS_PATH_MAX];
-    char line[LINE_MAX];
-    int fd;
-    int rss = 0;
-    int total;
-    ssize_t ret;
+static void proc_heap_add(struct proc *procp) {
+    struct proc_heap *heap = &proc_heaps[ADJTOSLOT(procp->oomadj)];
 
-    /* gid containing AID_READPROC required */
-    snprintf(path, PROCFS_PATH_MAX, "/proc/%d/statm", pid);
-    fd = open(path, O_RDONLY | O_CLOEXEC);
-    if (fd == -1)
-        return -1;
+    procp->heap_idx = -1;
+    if (heap->count == heap->capacity) {
+        int capacity = heap->capacity ? heap->capacity * 2 : PROC_HEAP_MIN_SIZE;
+        struct proc **procs = static_cast<struct proc**>(
+                realloc(heap->procs, capacity * sizeof(*procs)));
 
-    ret = read_all(fd, line, sizeof(line) - 1);
-    if (ret < 0) {
-        close(fd);
-        return -1;
+        if (!procs) {
+            ALOGE("Failed to grow the process heap of oom_score_adj %d", procp->oomadj);
+            heap->incomplete = true;
+            return;
+        }
+        heap->procs = procs;
+        heap->capacity = capacity;
     }
-    line[ret] = '\0';
-
-    sscanf(line, "%d %d ", &total, &rss);
-    close(fd);
-    return rss;
+    if (procp->rss_pages < 0) {
+        heap->unsampled++;
+    }
+    proc_heap_set(heap, heap->count++, procp);
+    proc_heap_sift_up(heap, procp->heap_idx);
 }
 
-static char *proc_get_name(int pid, char *buf, size_t buf_size) {
-    char path[PROCFS_PATH_MAX];
-    int fd;
-    char *cp;
-    ssize_t ret;
+static void proc_heap_del(struct proc *procp) {
+    struct proc_heap *heap = &proc_heaps[ADJTOSLOT(procp->oomadj)];
+    int idx = procp->heap_idx;
+    struct proc *last;
 
-    /* gid containing AID_READPROC required */
-    snprintf(path, PROCFS_PATH_MAX, "/proc/%d/cmdline", pid);
-    fd = open(path, O_RDONLY | O_CLOEXEC);
-    if (fd == -1) {
-        return NULL;
+    if (idx < 0) {
+        return;
     }
-    ret = read_all(fd, buf, buf_size - 1);
-    close(fd);
-    if (ret <= 0) {
-        return NULL;
+    if (procp->rss_pages < 0) {
+        heap->unsampled--;
     }
-    buf[ret] = '\0';
-
-    cp = strchr(buf, ' ');
+    last = heap->procs[--heap->count];
+    if (idx < heap->count) {
+        proc_heap_set(heap, idx, last);
+        proc_heap_sift_up(heap, idx);
+        proc_heap_sift_down(heap, last->heap_idx);
+    }
+    procp->heap_idx = -1;
+    if (heap->count == 0) {
+        heap->incomplete = false;
+    }
+}
+
+/* Restores the heap order after procp->rss_pages changed from old_rss_pages */
+static void proc_heap_update(struct proc *procp, int old_rss_pages) {
+    struct proc_heap *heap = &proc_heaps[ADJTOSLOT(procp->oomadj)];
+
+    if (procp->heap_idx < 0) {
+        return;
+    }
+    if (old_rss_pages < 0 && procp->rss_pages >= 0) {
+        heap->unsampled--;
+    }
+    if (procp->rss_pages > old_rss_pages) {
+        proc_heap_sift_up(heap, procp->heap_idx);
+    } else {
+        proc_heap_sift_down(heap, procp->heap_idx);
+    }
+}
+
+static void proc_link(struct proc *procp) {
+    int adjslot = ADJTOSLOT(procp->oomadj);
+
+    adjslot_insert(&procadjslot_list[adjslot], &procp->asl);
+    adjslot_bitmap_set(&procadjslot_bitmap, adjslot);
+    proc_heap_add(procp);
+    procadjslot_gen++;
+}
+
+static void proc_unlink(struct proc *procp) {
+    int adjslot = ADJTOSLOT(procp->oomadj);
+
+    adjslot_remove(&procp->asl);
+    if (procadjslot_list[adjslot].next == &procadjslot_list[adjslot]) {
+        adjslot_bitmap_clear(&procadjslot_bitmap, adjslot);
+    }
+    proc_heap_del(procp);
+    procadjslot_gen++;
+}
+
+// Should be modified only from the main thread.
+static void proc_slot(struct proc *procp) {
+    proc_link(procp);
+}
+
+// Should be modified only from the main thread.
+static void proc_unslot(struct proc *procp) {
+    proc_unlink(procp);
+}
+
+/*
+ * Kill candidates published by the main thread for other threads, which read them without locks.
+ * The main thread rebuilds the snapshot which is not published and then publishes it. Readers
+ * announce themselves in readers before using a snapshot and the main thread rebuilds only a
+ * snapshot without readers. Candidates are ordered from the highest oomadj level down and least
+ * recently used first within a level.
+ */
+struct proc_candidate {
+    int pid;
+    int pidfd;
+    uid_t uid;
+    int oomadj;
+    uint32_t gen;
+};
+
+struct proc_snapshot {
+    std::atomic<int> readers;
+    // procadjslot_gen the snapshot was built at
+    uint64_t gen;
+    std::vector<struct proc_candidate> procs;
+};
+
+static struct proc_snapshot proc_snapshots[2];
+static std::atomic<struct proc_snapshot*> proc_snapshot_current(&proc_snapshots[0]);
+
+/*
+ * Readers tolerate a somewhat stale view: the watchdog kills through pidfds and the sampler picks
+ * up new processes in its next round. Rebuilding is O(n), so changes are published at most once
+ * per interval to keep a burst of registrations from rebuilding the snapshot on every wakeup.
+ */
+#define PROC_SNAPSHOT_MIN_INTERVAL_MS 500
+/* delay before retrying to publish when the previous snapshot still has readers */
+#define PROC_SNAPSHOT_RETRY_MS 10
+/* when the current snapshot was published, used only from the main thread */
+static struct timespec proc_snapshot_tm;
+
+/*
+ * Published snapshots hold pidfds of removed processes, those are closed once no reader can use
+ * them. Used only from the main thread.
+ */
+/* pidfds removed since the current snapshot was published */
+static std::vector<int> pidfds_pending_close;
+/* pidfds referenced only by the previously published snapshot */
+static std::vector<int> pidfds_retiring;
+
+// Can be called only from the main thread.
+static void pidfd_close_deferred(int pidfd) {
+    pidfds_pending_close.push_back(pidfd);
+}
+
+/*
+ * Closes the pidfds referenced only by the previous snapshot once it has no readers. Returns true
+ * if they are still waiting for its readers. Can be called only from the main thread.
+ */
+static bool proc_snapshot_retire_pidfds(struct proc_snapshot *prev) {
+    if (pidfds_retiring.empty()) {
+        return false;
+    }
+    if (prev->readers.load() > 0) {
+        return true;
+    }
+    for (int pidfd : pidfds_retiring) {
+        close(pidfd);
+    }
+    pidfds_retiring.clear();
+    return false;
+}
+
+/*
+ * Publishes the current kill candidates if they changed and the last publish is at least
+ * PROC_SNAPSHOT_MIN_INTERVAL_MS old. Closes pidfds of removed processes once no snapshot which
+ * references them is read. Returns the delay in ms after which a deferred publish or close should
+ * be retried or -1 if nothing is pending. Can be called only from the main thread.
+ */
+static long proc_snapshot_publish(struct timespec *tm) {
+    struct proc_snapshot *curr = proc_snapshot_current.load();
+    struct proc_snapshot *next = curr == &proc_snapshots[0] ? &proc_snapshots[1] :
+                                                               &proc_snapshots[0];
+    long elapsed_ms;
+
+    /* checked on every pass, so that they don't wait for the next change to be published */
+    if (proc_snapshot_retire_pidfds(next)) {
+        /* a reader still uses the previous snapshot, retry later */
+        return PROC_SNAPSHOT_RETRY_MS;
+    }
+    if (curr->gen == procadjslot_gen) {
+        return -1;
+    }
+    elapsed_ms = get_time_diff_ms(&proc_snapshot_tm, tm);
+    if (elapsed_ms < PROC_SNAPSHOT_MIN_INTERVAL_MS) {
+        return PROC_SNAPSHOT_MIN_INTERVAL_MS - elapsed_ms;
+    }
+    if (next->readers.load() > 0) {
+        return PROC_SNAPSHOT_RETRY_MS;
+    }
+
+    next->procs.clear();
+    for (int oomadj = proc_adj_prev_occupied(OOM_SCORE_ADJ_MAX); oomadj >= OOM_SCORE_ADJ_MIN;
+         oomadj = proc_adj_prev_occupied(oomadj - 1)) {
+        struct adjslot_list *head = &procadjslot_list[ADJTOSLOT(oomadj)];
+
+        for (struct adjslot_list *curr_asl = head->prev; curr_asl != head;
+             curr_asl = curr_asl->prev) {
+            struct proc *procp = (struct proc *)curr_asl;
+
+            if (procp->valid) {
+                next->procs.push_back({ procp->pid, procp->pidfd, procp->uid, oomadj, procp->gen });
+            }
+        }
+    }
+    next->gen = procadjslot_gen;
+    proc_snapshot_current.store(next);
+    proc_snapshot_tm = *tm;
+    /* pidfds removed since curr was published are referenced only by curr now */
+    pidfds_retiring.swap(pidfds_pending_close);
+    return proc_snapshot_retire_pidfds(curr) ? PROC_SNAPSHOT_RETRY_MS : -1;
+}
+
+/* Returns the published snapshot, which stays valid until proc_snapshot_release() */
+static struct proc_snapshot *proc_snapshot_acquire() {
+    struct proc_snapshot *snapshot;
+
+    while (true) {
+        snapshot = proc_snapshot_current.load();
+        snapshot->readers.fetch_add(1);
+        /* the main thread might have started rebuilding it before it saw the reader */
+        if (snapshot == proc_snapshot_current.load()) {
+            return snapshot;
+        }
+        snapshot->readers.fetch_sub(1);
+    }
+}
+
+static void proc_snapshot_release(struct proc_snapshot *snapshot) {
+    snapshot->readers.fetch_sub(1);
+}
+
+/*
+ * struct proc records are allocated from mlocked chunks of proc_pool_chunk_size records, so that
+ * registering processes does not hit the heap. Chunks are never freed. Free records are linked
+ * through their asl.next. The pool is grown ahead of demand while there is no memory pressure,
+ * see proc_pool_refill(). Used only from the main thread.
+ */
+static struct adjslot_list *proc_pool_free_list;
+static uint32_t proc_pool_capacity;
+static uint32_t proc_pool_used;
+static uint32_t proc_pool_high_water;
+
+static bool proc_pool_grow() {
+    size_t size = proc_pool_chunk_size * sizeof(struct proc);
+    struct proc *chunk;
+
+    chunk = static_cast<struct proc*>(calloc(proc_pool_chunk_size, sizeof(struct proc)));
+    if (!chunk) {
+        ALOGE("Failed to allocate %d process records", proc_pool_chunk_size);
+        return false;
+    }
+    /* CAP_IPC_LOCK required */
+    if (mlock(chunk, size)) {
+        ALOGW("Process record pool mlock failed: %s", strerror(errno));
+    }
+    for (int i = proc_pool_chunk_size - 1; i >= 0; i--) {
+        chunk[i].asl.next = proc_pool_free_list;
+        proc_pool_free_list = &chunk[i].asl;
+    }
+    proc_pool_capacity += proc_pool_chunk_size;
+    ALOGI("Process record pool grown to %u records, %u used, high-water mark %u",
+          proc_pool_capacity, proc_pool_used, proc_pool_high_water);
+    return true;
+}
+
+static struct proc *proc_pool_alloc() {
+    struct proc *procp;
+
+    /* growing here means proc_pool_refill() did not keep up */
+    if (!proc_pool_free_list && !proc_pool_grow()) {
+        return NULL;
+    }
+    procp = (struct proc *)proc_pool_free_list;
+    proc_pool_free_list = procp->asl.next;
+    memset(procp, 0, sizeof(*procp));
+    proc_pool_used++;
+    proc_pool_high_water = std::max(proc_pool_high_water, proc_pool_used);
+    return procp;
+}
+
+static void proc_pool_release(struct proc *procp) {
+    procp->asl.next = proc_pool_free_list;
+    proc_pool_free_list = &procp->asl;
+    proc_pool_used--;
+}
+
+/* Grows the pool when less than a quarter of a chunk is left, call only outside of pressure */
+static void proc_pool_refill() {
+    if (proc_pool_capacity - proc_pool_used < (uint32_t)proc_pool_chunk_size / 4) {
+        proc_pool_grow();
+    }
+}
+
+/*
+ * Sizes the unpublished snapshot for the whole record pool, so that rebuilding it does not
+ * allocate under pressure. Call only outside of pressure from the main thread.
+ */
+static void proc_snapshot_reserve() {
+    struct proc_snapshot *curr = proc_snapshot_current.load();
+    struct proc_snapshot *next = curr == &proc_snapshots[0] ? &proc_snapshots[1] :
+                                                               &proc_snapshots[0];
+
+    /* the previous snapshot might still be read, publishing makes it the next one again */
+    if (next->readers.load() == 0) {
+        next->procs.reserve(proc_pool_capacity);
+    }
+}
+
+/*
+ * Records hashed by uid to find all processes of an app. App uids are allocated sequentially, so
+ * their low bits spread well. Used only from the main thread.
+ */
+#define UIDHASH_SIZE 256
+#define uid_hashfn(x) ((x) & (UIDHASH_SIZE - 1))
+static struct adjslot_list uidhash[UIDHASH_SIZE];
+
+#define uid_list_to_proc(list) \
+    ((struct proc *)((char *)(list) - offsetof(struct proc, uid_list)))
+
+#define reg_to_proc(node) \
+    ((struct proc *)((char *)(node) - offsetof(struct proc, reg)))
+
+// Should be modified only from the main thread.
+static bool proc_insert(struct proc *procp) {
+    if (procp->pid <= 0) {
+        return false;
+    }
+    if (!pid_table.insert(procp->pid, procp)) {
+        return false;
+    }
+    registrants.insert(&procp->reg);
+    adjslot_insert(&uidhash[uid_hashfn(procp->uid)], &procp->uid_list);
+    /* with the kernel driver records only keep names for kill reports, they are not candidates */
+    if (!use_inkernel_interface) {
+        proc_link(procp);
+    }
+    return true;
+}
+
+// Can be called only from the main thread.
+static int pid_remove(int pid) {
+    struct proc *procp = pid_table.erase(pid);
+
+    if (!procp) {
+        return -1;
+    }
+    if (!use_inkernel_interface) {
+        proc_unlink(procp);
+    }
+    registrants.remove(&procp->reg);
+    adjslot_remove(&procp->uid_list);
+    proc_names.release(procp->name);
+    /*
+     * Close pidfd here if we are not waiting for corresponding process to die,
+     * in which case stop_wait_for_proc_kill() will close the pidfd later
+     */
+    if (procp->pidfd >= 0 && !is_waiting_for_fd(procp->pidfd)) {
+        pidfd_close_deferred(procp->pidfd);
+    }
+    proc_pool_release(procp);
+    return 0;
+}
+
+// Can be called only from the main thread.
+static void pid_invalidate(int pid) {
+    struct proc *procp = pid_lookup(pid);
+
+    if (procp) {
+        procp->valid = false;
+    }
+}
+
+/*
+ * Write a string to a file.
+ * Returns false if the file does not exist.
+ */
+static bool writefilestring(const char *path, const char *s,
+                            bool err_if_missing) {
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    ssize_t len = strlen(s);
+    ssize_t ret;
+
+    if (fd < 0) {
+        if (err_if_missing) {
+            ALOGE("Error opening %s; errno=%d", path, errno);
+        }
+        return false;
+    }
+
+    ret = TEMP_FAILURE_RETRY(write(fd, s, len));
+    if (ret < 0) {
+        ALOGE("Error writing %s; errno=%d", path, errno);
+    } else if (ret < len) {
+        ALOGE("Short write on %s; length=%zd", path, ret);
+    }
+
+    close(fd);
+    return true;
+}
+
+static inline long get_time_diff_ms(struct timespec *from,
+                                    struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * (long)MS_PER_SEC +
+           (to->tv_nsec - from->tv_nsec) / (long)NS_PER_MS;
+}
+
+static inline long get_time_diff_us(struct timespec *from,
+                                    struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * (long)US_PER_SEC +
+           (to->tv_nsec - from->tv_nsec) / (long)NS_PER_US;
+}
+
+/* Reads /proc/pid/status into buf. */
+static bool read_proc_status(int pid, char *buf, size_t buf_sz) {
+    char path[PROCFS_PATH_MAX];
+    int fd;
+    ssize_t size;
+
+    snprintf(path, PROCFS_PATH_MAX, "/proc/%d/status", pid);
+    fd = procfs_open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    size = read_all(fd, buf, buf_sz - 1);
+    close(fd);
+    if (size <= 0) {
+        return false;
+    }
+    buf[size] = 0;
+    return true;
+}
+
+/* Looks for tag in buf and parses the first integer */
+static bool parse_status_tag(char *buf, const char *tag, int64_t *out) {
+    char *pos = buf;
+    while (true) {
+        pos = strstr(pos, tag);
+        /* Stop if tag not found or found at the line beginning */
+        if (pos == NULL || pos == buf || pos[-1] == '\n') {
+            break;
+        }
+        pos++;
+    }
+
+    if (pos == NULL) {
+        return false;
+    }
+
+    pos += strlen(tag);
+    while (*pos == ' ') ++pos;
+    return parse_int64(pos, out);
+}
+
+static int proc_get_size(int pid) {
+    char path[PROCFS_PATH_MAX];
+    char line[LINE_MAX];
+    const char *pos;
+    int fd;
+    int64_t rss;
+    int64_t total;
+    ssize_t ret;
+
+    /* gid containing AID_READPROC required */
+    snprintf(path, PROCFS_PATH_MAX, "/proc/%d/statm", pid);
+    fd = procfs_open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+
+    ret = read_all(fd, line, sizeof(line) - 1);
+    if (ret < 0) {
+        close(fd);
+        return -1;
+    }
+    line[ret] = '\0';
+
+    close(fd);
+    /* statm starts with "<total> <rss> " */
+    if (!(pos = scan_int64(line, &total)) || !scan_int64(pos, &rss)) {
+        return 0;
+    }
+    return (int)rss;
+}
+
+static char *proc_get_name(int pid, char *buf, size_t buf_size) {
+    char path[PROCFS_PATH_MAX];
+    int fd;
+    char *cp;
+    ssize_t ret;
+
+    /* gid containing AID_READPROC required */
+    snprintf(path, PROCFS_PATH_MAX, "/proc/%d/cmdline", pid);
+    fd = procfs_open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+    ret = read_all(fd, buf, buf_size - 1);
+    close(fd);
+    if (ret <= 0) {
+        return NULL;
+    }
+    buf[ret] = '\0';
+
+    cp = strchr(buf, ' ');
     if (cp) {
         *cp = '\0';
     }
@@ -1130,6 +1619,82 @@ static char *proc_get_name(int pid, char *buf, size_t buf_size) {
     return buf;
 }
 
+/* Returns the cached name of a registered process, otherwise reads it into buf */
+static const char *proc_get_cached_name(int pid, char *buf, size_t buf_size) {
+    struct proc *procp = pid_lookup(pid);
+
+    if (procp && procp->name != NameArena::INVALID_HANDLE) {
+        return proc_cached_name(procp);
+    }
+    return proc_get_name(pid, buf, buf_size);
+}
+
+/*
+ * Names are cached only for kills reported without reading cmdline: kills by the kernel driver,
+ * whose name is used only in statsd reports, and signal-first kills. Otherwise the kill path reads
+ * the name when it needs it.
+ */
+static bool proc_cache_names() {
+    return (use_inkernel_interface && stats_log_enabled()) || kill_signal_first;
+}
+
+/*
+ * Reads the name of the process and caches it in its record unless the cached name is the same.
+ * Apps are often registered before they get renamed from "<pre-initialized>", so the name is
+ * refreshed on every LMK_PROCPRIO. Can be called only from the main thread.
+ */
+static void proc_update_name(struct proc *procp) {
+    char buf[MAX_TASKNAME_LEN];
+    const char *cached = proc_cached_name(procp);
+    const char *name = proc_get_name(procp->pid, buf, sizeof(buf));
+
+    if (!name || (cached && !strcmp(cached, name))) {
+        return;
+    }
+    proc_names.release(procp->name);
+    procp->name = proc_names.store(name);
+}
+
+/*
+ * Creates and inserts the record of a newly registered process. Closes pidfd on failure.
+ * Can be called only from the main thread.
+ */
+static struct proc *proc_create(const struct lmk_procprio& proc, int oomadj, int pidfd,
+                                pid_t reg_pid) {
+    struct proc *procp = proc_pool_alloc();
+
+    if (!procp) {
+        // Oh, the irony.  May need to rebuild our state.
+        if (pidfd >= 0) {
+            close(pidfd);
+        }
+        return NULL;
+    }
+
+    procp->pid = proc.pid;
+    procp->pidfd = pidfd;
+    procp->uid = proc.uid;
+    procp->reg.reg_pid = reg_pid;
+    procp->oomadj = oomadj;
+    procp->valid = true;
+    procp->gen = ++proc_gen;
+    procp->rss_pages = -1;
+    procp->name = NameArena::INVALID_HANDLE;
+    if (proc_cache_names()) {
+        proc_update_name(procp);
+    }
+    if (!proc_insert(procp)) {
+        ALOGE("Failed to register process %d", proc.pid);
+        if (pidfd >= 0) {
+            close(pidfd);
+        }
+        proc_names.release(procp->name);
+        proc_pool_release(procp);
+        return NULL;
+    }
+    return procp;
+}
+
 static void register_oom_adj_proc(const struct lmk_procprio& proc, struct ucred* cred) {
     char val[20];
     int soft_limit_mult;
@@ -1197,23 +1762,11 @@ static void register_oom_adj_proc(const struct lmk_procprio& proc, struct ucred*
             }
         }
 
-        procp = static_cast<struct proc*>(calloc(1, sizeof(struct proc)));
-        if (!procp) {
-            // Oh, the irony.  May need to rebuild our state.
-            return;
-        }
-
-        procp->pid = proc.pid;
-        procp->pidfd = pidfd;
-        procp->uid = proc.uid;
-        procp->reg_pid = cred->pid;
-        procp->oomadj = oom_adj_score;
-        procp->valid = true;
-        proc_insert(procp);
+        proc_create(proc, oom_adj_score, pidfd, cred->pid);
     } else {
-        if (!claim_record(procp, cred->pid)) {
+        if (!registrants.claim(&procp->reg, cred->pid)) {
             char buf[LINE_MAX];
-            char *taskname = proc_get_name(cred->pid, buf, sizeof(buf));
+            const char *taskname = proc_get_cached_name(cred->pid, buf, sizeof(buf));
             /* Only registrant of the record can remove it */
             ALOGE("%s (%d, %d) attempts to modify a process registered by another client",
                 taskname ? taskname : "A process ", cred->uid, cred->pid);
@@ -1222,6 +1775,9 @@ static void register_oom_adj_proc(const struct lmk_procprio& proc, struct ucred*
         proc_unslot(procp);
         procp->oomadj = oom_adj_score;
         proc_slot(procp);
+        if (proc_cache_names()) {
+            proc_update_name(procp);
+        }
     }
 }
 
@@ -1264,7 +1820,14 @@ static void apply_proc_prio(const struct lmk_procprio& params, struct ucred* cre
     }
 
     if (use_inkernel_interface) {
-        stats_store_taskname(params.pid, proc_get_name(params.pid, path, sizeof(path)));
+        /* the kernel driver kills processes, keep the name for its kill reports */
+        struct proc *procp = pid_lookup(params.pid);
+
+        if (procp) {
+            proc_update_name(procp);
+        } else {
+            proc_create(params, params.oomadj, -1, cred->pid);
+        }
         return;
     }
 
@@ -1293,7 +1856,7 @@ static void cmd_procremove(LMKD_CTRL_PACKET packet, struct ucred *cred) {
          */
         poll_kernel(kpoll_fd);
 
-        stats_remove_taskname(params.pid);
+        pid_remove(params.pid);
         return;
     }
 
@@ -1302,9 +1865,9 @@ static void cmd_procremove(LMKD_CTRL_PACKET packet, struct ucred *cred) {
         return;
     }
 
-    if (!claim_record(procp, cred->pid)) {
+    if (!registrants.claim(&procp->reg, cred->pid)) {
         char buf[LINE_MAX];
-        char *taskname = proc_get_name(cred->pid, buf, sizeof(buf));
+        const char *taskname = proc_get_cached_name(cred->pid, buf, sizeof(buf));
         /* Only registrant of the record can remove it */
         ALOGE("%s (%d, %d) attempts to unregister a process registered by another client",
             taskname ? taskname : "A process ", cred->uid, cred->pid);
@@ -1319,26 +1882,10 @@ static void cmd_procremove(LMKD_CTRL_PACKET packet, struct ucred *cred) {
 }
 
 static void cmd_procpurge(struct ucred *cred) {
-    int i;
-    struct proc *procp;
-    struct proc *next;
-
-    if (use_inkernel_interface) {
-        stats_purge_tasknames();
-        return;
-    }
-
-    for (i = 0; i < PIDHASH_SZ; i++) {
-        procp = pidhash[i];
-        while (procp) {
-            next = procp->pidhash_next;
-            /* Purge only records created by the requestor */
-            if (claim_record(procp, cred->pid)) {
-                pid_remove(procp->pid);
-            }
-            procp = next;
-        }
-    }
+    /* Purge only records created by the requestor or claimable by it */
+    registrants.purge(cred->pid, [](Registrants::node *node) {
+        pid_remove(reg_to_proc(node)->pid);
+    });
 }
 
 static void cmd_subscribe(int dsock_idx, LMKD_CTRL_PACKET packet) {
@@ -1348,35 +1895,36 @@ static void cmd_subscribe(int dsock_idx, LMKD_CTRL_PACKET packet) {
     data_sock[dsock_idx].async_event_mask |= 1 << params.evt_type;
 }
 
-static void inc_killcnt(int oomadj) {
-    int slot = ADJTOSLOT(oomadj);
-    uint8_t idx = killcnt_idx[slot];
+static int killhist_bucket(enum kill_reasons reason) {
+    if (reason >= VENDOR_KILL_REASON_BASE) {
+        return KILLHIST_BUCKET_COUNT - 1;
+    }
+    if (reason < 0 || reason >= AOSP_KILL_REASON_COUNT) {
+        return 0;
+    }
+    return reason + 1;
+}
 
-    if (idx == KILLCNT_INVALID_IDX) {
-        /* index is not assigned for this oomadj */
-        if (killcnt_free_idx < MAX_DISTINCT_OOM_ADJ) {
-            killcnt_idx[slot] = killcnt_free_idx;
-            killcnt[killcnt_free_idx] = 1;
-            killcnt_free_idx++;
-        } else {
-            ALOGW("Number of distinct oomadj levels exceeds %d",
-                MAX_DISTINCT_OOM_ADJ);
-        }
-    } else {
-        /*
-         * wraparound is highly unlikely and is detectable using total
-         * counter because it has to be equal to the sum of all counters
-         */
-        killcnt[idx]++;
+static void inc_killcnt(int oomadj, enum kill_reasons reason) {
+    for (int i = ADJTOSLOT(oomadj) + 1; i <= ADJTOSLOT_COUNT; i += i & -i) {
+        killcnt_tree[i]++;
     }
+    killhist[killhist_bucket(reason)]++;
     /* increment total kill counter */
     killcnt_total++;
 }
 
-static int get_killcnt(int min_oomadj, int max_oomadj) {
-    int slot;
-    int count = 0;
+/* Returns the number of kills at slots [0, slot] */
+static uint64_t killcnt_prefix_sum(int slot) {
+    uint64_t count = 0;
 
+    for (int i = slot + 1; i > 0; i -= i & -i) {
+        count += killcnt_tree[i];
+    }
+    return count;
+}
+
+static uint64_t get_killcnt(int min_oomadj, int max_oomadj) {
     if (min_oomadj > max_oomadj)
         return 0;
 
@@ -1384,16 +1932,13 @@ static int get_killcnt(int min_oomadj, int max_oomadj) {
     if (min_oomadj > OOM_SCORE_ADJ_MAX)
         return killcnt_total;
 
-    while (min_oomadj <= max_oomadj &&
-           (slot = ADJTOSLOT(min_oomadj)) < ADJTOSLOT_COUNT) {
-        uint8_t idx = killcnt_idx[slot];
-        if (idx != KILLCNT_INVALID_IDX) {
-            count += killcnt[idx];
-        }
-        min_oomadj++;
-    }
+    if (max_oomadj < OOM_SCORE_ADJ_MIN)
+        return 0;
 
-    return count;
+    min_oomadj = std::max(min_oomadj, OOM_SCORE_ADJ_MIN);
+    max_oomadj = std::min(max_oomadj, OOM_SCORE_ADJ_MAX);
+    return killcnt_prefix_sum(ADJTOSLOT(max_oomadj)) -
+           killcnt_prefix_sum(ADJTOSLOT(min_oomadj) - 1);
 }
 
 static int cmd_getkillcnt(LMKD_CTRL_PACKET packet) {
@@ -1406,7 +1951,8 @@ static int cmd_getkillcnt(LMKD_CTRL_PACKET packet) {
 
     lmkd_pack_get_getkillcnt(packet, &params);
 
-    return get_killcnt(params.min_oomadj, params.max_oomadj);
+    /* the reply carries an int, saturate instead of wrapping around */
+    return (int)std::min(get_killcnt(params.min_oomadj, params.max_oomadj), (uint64_t)INT_MAX);
 }
 
 static void cmd_target(int ntargets, LMKD_CTRL_PACKET packet) {
@@ -1555,6 +2101,16 @@ static void ctrl_command_handler(int dsock_idx) {
         if (ctrl_data_write(dsock_idx, (char *)packet, len) != len)
             return;
         break;
+    case LMK_GETKILLHIST: {
+        LMKD_KILLHIST_PACKET hist_packet;
+
+        if (nargs != 0)
+            goto wronglen;
+        len = lmkd_pack_set_getkillhist_repl(hist_packet, killhist, KILLHIST_BUCKET_COUNT);
+        if (ctrl_data_write(dsock_idx, (char *)hist_packet, len) != len)
+            return;
+        break;
+    }
     case LMK_SUBSCRIBE:
         if (nargs != 1)
             goto wronglen;
@@ -1681,6 +2237,7 @@ static void ctrl_connect_handler(int data __unused, uint32_t events __unused,
                                  struct polling_params *poll_params __unused) {
     struct epoll_event epev;
     int free_dscock_idx = get_free_dsock();
+    int sock;
 
     if (free_dscock_idx < 0) {
         /*
@@ -1696,8 +2253,8 @@ static void ctrl_connect_handler(int data __unused, uint32_t events __unused,
         free_dscock_idx = 0;
     }
 
-    data_sock[free_dscock_idx].sock = accept(ctrl_sock.sock, NULL, NULL);
-    if (data_sock[free_dscock_idx].sock < 0) {
+    sock = accept(ctrl_sock.sock, NULL, NULL);
+    if (sock < 0) {
         ALOGE("lmkd control socket accept failed; errno=%d", errno);
         return;
     }
@@ -1706,6 +2263,7 @@ static void ctrl_connect_handler(int data __unused, uint32_t events __unused,
     /* use data to store data connection idx */
     data_sock[free_dscock_idx].handler_info.data = free_dscock_idx;
     data_sock[free_dscock_idx].handler_info.handler = ctrl_data_handler;
+    data_sock[free_dscock_idx].sock = sock;
     data_sock[free_dscock_idx].async_event_mask = 0;
     epev.events = EPOLLIN;
     epev.data.ptr = (void *)&(data_sock[free_dscock_idx].handler_info);
@@ -1765,7 +2323,7 @@ static int zoneinfo_parse_zone(char **buf, struct zoneinfo_zone *zone) {
             return false;
         }
 
-        field_idx = find_field(cp, zoneinfo_zone_spec_field_names, ZI_ZONE_SPEC_FIELD_COUNT);
+        field_idx = zoneinfo_zone_spec_field_index.find(cp);
         if (field_idx >= 0) {
             /* special field */
             if (field_idx == ZI_ZONE_SPEC_PAGESETS) {
@@ -1786,8 +2344,7 @@ static int zoneinfo_parse_zone(char **buf, struct zoneinfo_zone *zone) {
             continue;
         }
 
-        match_res = match_field(cp, ap, zoneinfo_zone_field_names, ZI_ZONE_FIELD_COUNT,
-            &val, &field_idx);
+        match_res = match_field(cp, ap, zoneinfo_zone_field_index, &val, &field_idx);
         if (match_res == PARSE_FAIL) {
             return false;
         }
@@ -1824,8 +2381,7 @@ static int zoneinfo_parse_node(char **buf, struct zoneinfo_node *node) {
             return false;
         }
 
-        match_res = match_field(cp, ap, zoneinfo_node_field_names, ZI_NODE_FIELD_COUNT,
-            &val, &field_idx);
+        match_res = match_field(cp, ap, zoneinfo_node_field_index, &val, &field_idx);
         if (match_res == PARSE_FAIL) {
             return false;
         }
@@ -1841,10 +2397,6 @@ static int zoneinfo_parse_node(char **buf, struct zoneinfo_node *node) {
 }
 
 static int zoneinfo_parse(struct zoneinfo *zi) {
-    static struct reread_data file_data = {
-        .filename = ZONEINFO_PATH,
-        .fd = -1,
-    };
     char *buf;
     char *save_ptr;
     char *line;
@@ -1853,9 +2405,12 @@ static int zoneinfo_parse(struct zoneinfo *zi) {
     int node_idx = 0;
     int zone_idx = 0;
 
-    memset(zi, 0, sizeof(struct zoneinfo));
+    zi->node_count = 0;
+    zi->totalreserve_pages = 0;
+    zi->total_inactive_file = 0;
+    zi->total_active_file = 0;
 
-    if ((buf = reread_file(&file_data)) == NULL) {
+    if ((buf = reread_file(&zoneinfo_file_data)) == NULL) {
         return -1;
     }
 
@@ -1877,17 +2432,16 @@ static int zoneinfo_parse(struct zoneinfo *zi) {
                 if (node) {
                     node->zone_count = zone_idx + 1;
                     node_idx++;
-                    if (node_idx == MAX_NR_NODES) {
-                        /* max node count exceeded */
-                        ALOGE("%s parse error", file_data.filename);
-                        return -1;
-                    }
+                }
+                if (node_idx == (int)zi->nodes.size()) {
+                    zi->nodes.emplace_back();
                 }
                 node = &zi->nodes[node_idx];
+                memset(node, 0, sizeof(struct zoneinfo_node));
                 node->id = node_id;
                 zone_idx = 0;
                 if (!zoneinfo_parse_node(&save_ptr, node)) {
-                    ALOGE("%s parse error", file_data.filename);
+                    ALOGE("%s parse error", zoneinfo_file_data.filename);
                     return -1;
                 }
             } else {
@@ -1895,13 +2449,13 @@ static int zoneinfo_parse(struct zoneinfo *zi) {
                 zone_idx++;
             }
             if (!zoneinfo_parse_zone(&save_ptr, &node->zones[zone_idx])) {
-                ALOGE("%s parse error", file_data.filename);
+                ALOGE("%s parse error", zoneinfo_file_data.filename);
                 return -1;
             }
         }
     }
     if (!node) {
-        ALOGE("%s parse error", file_data.filename);
+        ALOGE("%s parse error", zoneinfo_file_data.filename);
         return -1;
     }
     node->zone_count = zone_idx + 1;
@@ -1921,32 +2475,6 @@ static int zoneinfo_parse(struct zoneinfo *zi) {
 }
 
 /* /proc/meminfo parsing routines */
-static bool meminfo_parse_line(char *line, union meminfo *mi) {
-    char *cp = line;
-    char *ap;
-    char *save_ptr;
-    int64_t val;
-    int field_idx;
-    enum field_match_result match_res;
-
-    cp = strtok_r(line, " ", &save_ptr);
-    if (!cp) {
-        return false;
-    }
-
-    ap = strtok_r(NULL, " ", &save_ptr);
-    if (!ap) {
-        return false;
-    }
-
-    match_res = match_field(cp, ap, meminfo_field_names, MI_FIELD_COUNT,
-        &val, &field_idx);
-    if (match_res == PARSE_SUCCESS) {
-        mi->arr[field_idx] = val / page_k;
-    }
-    return (match_res != PARSE_FAIL);
-}
-
 static int64_t read_gpu_total_kb() {
     static android::base::unique_fd fd(
             android::bpf::mapRetrieveRO("/sys/fs/bpf/map_gpuMem_gpu_mem_total_map"));
@@ -1963,26 +2491,21 @@ static int64_t read_gpu_total_kb() {
 }
 
 static int meminfo_parse(union meminfo *mi) {
-    static struct reread_data file_data = {
-        .filename = MEMINFO_PATH,
-        .fd = -1,
-    };
+    static struct field_layout layout;
     char *buf;
-    char *save_ptr;
-    char *line;
 
     memset(mi, 0, sizeof(union meminfo));
 
-    if ((buf = reread_file(&file_data)) == NULL) {
+    if ((buf = reread_file(&meminfo_file_data)) == NULL) {
         return -1;
     }
 
-    for (line = strtok_r(buf, "\n", &save_ptr); line;
-         line = strtok_r(NULL, "\n", &save_ptr)) {
-        if (!meminfo_parse_line(line, mi)) {
-            ALOGE("%s parse error", file_data.filename);
-            return -1;
-        }
+    if (parse_fields(buf, meminfo_field_index, &layout, mi->arr) < 0) {
+        ALOGE("%s parse error", meminfo_file_data.filename);
+        return -1;
+    }
+    for (int field_idx = 0; field_idx < MI_FIELD_COUNT; field_idx++) {
+        mi->arr[field_idx] /= page_k;
     }
     mi->field.nr_file_pages = mi->field.cached + mi->field.swap_cached +
         mi->field.buffers;
@@ -2005,53 +2528,19 @@ static inline int64_t get_free_swap(union meminfo *mi) {
 }
 
 /* /proc/vmstat parsing routines */
-static bool vmstat_parse_line(char *line, union vmstat *vs) {
-    char *cp;
-    char *ap;
-    char *save_ptr;
-    int64_t val;
-    int field_idx;
-    enum field_match_result match_res;
-
-    cp = strtok_r(line, " ", &save_ptr);
-    if (!cp) {
-        return false;
-    }
-
-    ap = strtok_r(NULL, " ", &save_ptr);
-    if (!ap) {
-        return false;
-    }
-
-    match_res = match_field(cp, ap, vmstat_field_names, VS_FIELD_COUNT,
-        &val, &field_idx);
-    if (match_res == PARSE_SUCCESS) {
-        vs->arr[field_idx] = val;
-    }
-    return (match_res != PARSE_FAIL);
-}
-
 static int vmstat_parse(union vmstat *vs) {
-    static struct reread_data file_data = {
-        .filename = VMSTAT_PATH,
-        .fd = -1,
-    };
+    static struct field_layout layout;
     char *buf;
-    char *save_ptr;
-    char *line;
 
     memset(vs, 0, sizeof(union vmstat));
 
-    if ((buf = reread_file(&file_data)) == NULL) {
+    if ((buf = reread_file(&vmstat_file_data)) == NULL) {
         return -1;
     }
 
-    for (line = strtok_r(buf, "\n", &save_ptr); line;
-         line = strtok_r(NULL, "\n", &save_ptr)) {
-        if (!vmstat_parse_line(line, vs)) {
-            ALOGE("%s parse error", file_data.filename);
-            return -1;
-        }
+    if (parse_fields(buf, vmstat_field_index, &layout, vs->arr, vmstat_field_groups) < 0) {
+        ALOGE("%s parse error", vmstat_file_data.filename);
+        return -1;
     }
 
     return 0;
@@ -2081,27 +2570,15 @@ static int psi_parse(struct reread_data *file_data, struct psi_stats stats[], bo
 }
 
 static int psi_parse_mem(struct psi_data *psi_data) {
-    static struct reread_data file_data = {
-            .filename = psi_resource_file[PSI_MEMORY],
-            .fd = -1,
-    };
-    return psi_parse(&file_data, psi_data->mem_stats, true);
+    return psi_parse(&psi_file_data[PSI_MEMORY], psi_data->mem_stats, true);
 }
 
 static int psi_parse_io(struct psi_data *psi_data) {
-    static struct reread_data file_data = {
-            .filename = psi_resource_file[PSI_IO],
-            .fd = -1,
-    };
-    return psi_parse(&file_data, psi_data->io_stats, true);
+    return psi_parse(&psi_file_data[PSI_IO], psi_data->io_stats, true);
 }
 
 static int psi_parse_cpu(struct psi_data *psi_data) {
-    static struct reread_data file_data = {
-            .filename = psi_resource_file[PSI_CPU],
-            .fd = -1,
-    };
-    return psi_parse(&file_data, psi_data->cpu_stats, false);
+    return psi_parse(&psi_file_data[PSI_CPU], psi_data->cpu_stats, false);
 }
 
 enum wakeup_reason {
@@ -2139,108 +2616,304 @@ static void record_wakeup_time(struct timespec *tm, enum wakeup_reason reason,
     }
 }
 
+/*
+ * Size of the kill reason description. The longest one, low swap and thrashing with three 64-bit
+ * values and the starved node suffix, takes 130 bytes.
+ */
+#define KILL_DESC_LEN 160
+
 struct kill_info {
     enum kill_reasons kill_reason;
+    /* up to KILL_DESC_LEN bytes including the terminating NUL */
     const char *kill_desc;
     int thrashing;
     int max_thrashing;
+    /* node whose exhaustion triggered the kill, -1 for a system-wide shortage */
+    int starved_node;
+};
+
+/* Number of kill reports which can be queued for the telemetry thread */
+#define TELEMETRY_RING_SIZE 32
+
+struct kill_client {
+    int sock;
+    uint32_t async_event_mask;
+};
+
+/*
+ * Everything reported about a kill. The telemetry thread must not access the state of the main
+ * thread, so the record holds copies instead of pointers. Strings are sized like their sources:
+ * names are reported up to MAX_TASKNAME_LEN as in statsd packets and descriptions are built in
+ * KILL_DESC_LEN buffers.
+ */
+struct kill_record {
+    int pid;
+    uid_t uid;
+    int oomadj;
+    int min_oom_score;
+    int64_t rss_kb;
+    int64_t swap_kb;
+    char taskname[MAX_TASKNAME_LEN];
+    bool has_ki;
+    enum kill_reasons kill_reason;
+    int thrashing;
+    int max_thrashing;
+    char kill_desc[KILL_DESC_LEN];
+    bool has_mi;
+    union meminfo mi;
+    bool has_wi;
+    struct wakeup_info wi;
+    struct timespec tm;
+    bool has_pd;
+    struct psi_data pd;
+    int64_t free_mem_kb;
+    int64_t free_swap_kb;
+    bool has_mem_st;
+    struct memory_stat mem_st;
+    /* duplicated sockets of the subscribed clients, closed once the kill is reported */
+    int client_cnt;
+    struct kill_client clients[MAX_DATA_CONN];
 };
 
-static void killinfo_log(struct proc* procp, int min_oom_score, int rss_kb,
-                         int swap_kb, struct kill_info *ki, union meminfo *mi,
-                         struct wakeup_info *wi, struct timespec *tm, struct psi_data *pd) {
+static void killinfo_log(android_log_context log_ctx, struct kill_record *rec) {
     /* log process information */
-    android_log_write_int32(ctx, procp->pid);
-    android_log_write_int32(ctx, procp->uid);
-    android_log_write_int32(ctx, procp->oomadj);
-    android_log_write_int32(ctx, min_oom_score);
-    android_log_write_int32(ctx, std::min(rss_kb, (int)INT32_MAX));
-    android_log_write_int32(ctx, ki ? ki->kill_reason : NONE);
+    android_log_write_int32(log_ctx, rec->pid);
+    android_log_write_int32(log_ctx, rec->uid);
+    android_log_write_int32(log_ctx, rec->oomadj);
+    android_log_write_int32(log_ctx, rec->min_oom_score);
+    android_log_write_int32(log_ctx, (int32_t)std::min(rec->rss_kb, (int64_t)INT32_MAX));
+    android_log_write_int32(log_ctx, rec->has_ki ? rec->kill_reason : NONE);
 
     /* log meminfo fields */
     for (int field_idx = 0; field_idx < MI_FIELD_COUNT; field_idx++) {
-        android_log_write_int32(ctx,
-                                mi ? std::min(mi->arr[field_idx] * page_k, (int64_t)INT32_MAX) : 0);
+        android_log_write_int32(log_ctx, rec->has_mi ?
+                std::min(rec->mi.arr[field_idx] * page_k, (int64_t)INT32_MAX) : 0);
     }
 
     /* log lmkd wakeup information */
-    if (wi) {
-        android_log_write_int32(ctx, (int32_t)get_time_diff_ms(&wi->last_event_tm, tm));
-        android_log_write_int32(ctx, (int32_t)get_time_diff_ms(&wi->prev_wakeup_tm, tm));
-        android_log_write_int32(ctx, wi->wakeups_since_event);
-        android_log_write_int32(ctx, wi->skipped_wakeups);
+    if (rec->has_wi) {
+        android_log_write_int32(log_ctx, (int32_t)get_time_diff_ms(&rec->wi.last_event_tm,
+                                                                   &rec->tm));
+        android_log_write_int32(log_ctx, (int32_t)get_time_diff_ms(&rec->wi.prev_wakeup_tm,
+                                                                   &rec->tm));
+        android_log_write_int32(log_ctx, rec->wi.wakeups_since_event);
+        android_log_write_int32(log_ctx, rec->wi.skipped_wakeups);
     } else {
-        android_log_write_int32(ctx, 0);
-        android_log_write_int32(ctx, 0);
-        android_log_write_int32(ctx, 0);
-        android_log_write_int32(ctx, 0);
+        android_log_write_int32(log_ctx, 0);
+        android_log_write_int32(log_ctx, 0);
+        android_log_write_int32(log_ctx, 0);
+        android_log_write_int32(log_ctx, 0);
     }
 
-    android_log_write_int32(ctx, std::min(swap_kb, (int)INT32_MAX));
-    android_log_write_int32(ctx, mi ? (int32_t)mi->field.total_gpu_kb : 0);
-    if (ki) {
-        android_log_write_int32(ctx, ki->thrashing);
-        android_log_write_int32(ctx, ki->max_thrashing);
+    android_log_write_int32(log_ctx, (int32_t)std::min(rec->swap_kb, (int64_t)INT32_MAX));
+    android_log_write_int32(log_ctx, rec->has_mi ? (int32_t)rec->mi.field.total_gpu_kb : 0);
+    if (rec->has_ki) {
+        android_log_write_int32(log_ctx, rec->thrashing);
+        android_log_write_int32(log_ctx, rec->max_thrashing);
     } else {
-        android_log_write_int32(ctx, 0);
-        android_log_write_int32(ctx, 0);
+        android_log_write_int32(log_ctx, 0);
+        android_log_write_int32(log_ctx, 0);
     }
 
-    if (pd) {
-        android_log_write_float32(ctx, pd->mem_stats[PSI_SOME].avg10);
-        android_log_write_float32(ctx, pd->mem_stats[PSI_FULL].avg10);
-        android_log_write_float32(ctx, pd->io_stats[PSI_SOME].avg10);
-        android_log_write_float32(ctx, pd->io_stats[PSI_FULL].avg10);
-        android_log_write_float32(ctx, pd->cpu_stats[PSI_SOME].avg10);
+    if (rec->has_pd) {
+        android_log_write_float32(log_ctx, rec->pd.mem_stats[PSI_SOME].avg10);
+        android_log_write_float32(log_ctx, rec->pd.mem_stats[PSI_FULL].avg10);
+        android_log_write_float32(log_ctx, rec->pd.io_stats[PSI_SOME].avg10);
+        android_log_write_float32(log_ctx, rec->pd.io_stats[PSI_FULL].avg10);
+        android_log_write_float32(log_ctx, rec->pd.cpu_stats[PSI_SOME].avg10);
     } else {
         for (int i = 0; i < 5; i++) {
-            android_log_write_float32(ctx, 0);
+            android_log_write_float32(log_ctx, 0);
         }
     }
 
-    android_log_write_list(ctx, LOG_ID_EVENTS);
-    android_log_reset(ctx);
+    android_log_write_list(log_ctx, LOG_ID_EVENTS);
+    android_log_reset(log_ctx);
 }
 
-// Note: returned entry is only an anchor and does not hold a valid process info.
-// When called from a non-main thread, adjslot_list_lock read lock should be taken.
-static struct proc *proc_adj_head(int oomadj) {
-    return (struct proc *)&procadjslot_list[ADJTOSLOT(oomadj)];
+/* Asynchronous events a kill is reported with */
+#define KILL_REPORT_EVENTS (1 << LMK_ASYNC_EVENT_STAT | 1 << LMK_ASYNC_EVENT_KILL)
+
+/*
+ * Writes a kill report to a client. Runs on the telemetry thread as well, where a client which
+ * disconnected must not raise SIGPIPE, hence send() instead of write().
+ */
+static void kill_client_write(int sock, char *buf, size_t bufsz) {
+    if (TEMP_FAILURE_RETRY(send(sock, buf, bufsz, MSG_NOSIGNAL)) < 0 && errno != EPIPE) {
+        ALOGE("kill report write failed; errno=%d", errno);
+    }
 }
 
-// When called from a non-main thread, adjslot_list_lock read lock should be taken.
-static struct proc *proc_adj_tail(int oomadj) {
-    return (struct proc *)adjslot_tail(&procadjslot_list[ADJTOSLOT(oomadj)]);
+/*
+ * Sends the kill to the clients, the statsd packet first and then LMK_PROCKILL, in the order
+ * clients always received them.
+ */
+static void report_kill_to_clients(struct kill_record *rec, const struct kill_client *clients,
+                                   int client_cnt) {
+    LMK_KILL_OCCURRED_PACKET stat_packet;
+    LMKD_CTRL_PACKET kill_packet;
+    struct kill_stat kill_st;
+    size_t stat_len;
+    size_t kill_len;
+
+    kill_st.uid = static_cast<int32_t>(rec->uid);
+    kill_st.taskname = rec->taskname;
+    kill_st.kill_reason = rec->has_ki ? rec->kill_reason : NONE;
+    kill_st.oom_score = rec->oomadj;
+    kill_st.min_oom_score = rec->min_oom_score;
+    kill_st.free_mem_kb = rec->free_mem_kb;
+    kill_st.free_swap_kb = rec->free_swap_kb;
+    kill_st.thrashing = rec->has_ki ? rec->thrashing : 0;
+    kill_st.max_thrashing = rec->has_ki ? rec->max_thrashing : 0;
+    /* builds without stats logging return -EINVAL */
+    stat_len = lmkd_pack_set_kill_occurred(stat_packet, &kill_st,
+                                           rec->has_mem_st ? &rec->mem_st : NULL);
+    kill_len = lmkd_pack_set_prockills(kill_packet, (pid_t)rec->pid, rec->uid,
+                                       static_cast<int>(rec->rss_kb));
+
+    for (int i = 0; i < client_cnt; i++) {
+        if (stat_len > 0 && stat_len <= sizeof(stat_packet) &&
+            clients[i].async_event_mask & 1 << LMK_ASYNC_EVENT_STAT) {
+            kill_client_write(clients[i].sock, stat_packet, stat_len);
+        }
+        if (clients[i].async_event_mask & 1 << LMK_ASYNC_EVENT_KILL) {
+            kill_client_write(clients[i].sock, (char*)kill_packet, kill_len);
+        }
+    }
 }
 
-// When called from a non-main thread, adjslot_list_lock read lock should be taken.
-static struct proc *proc_adj_prev(int oomadj, int pid) {
-    struct adjslot_list *head = &procadjslot_list[ADJTOSLOT(oomadj)];
-    struct adjslot_list *curr = adjslot_tail(&procadjslot_list[ADJTOSLOT(oomadj)]);
+/*
+ * Reports a kill to the clients and logd. Called on the telemetry thread, so the report may be
+ * dropped if the thread falls behind, in which case the main thread still notifies the clients.
+ */
+static void report_kill(void *record) {
+    struct kill_record *rec = static_cast<struct kill_record*>(record);
 
-    while (curr != head) {
-        if (((struct proc *)curr)->pid == pid) {
-            return (struct proc *)curr->prev;
+    /* clients act on kills, notify them before logging */
+    report_kill_to_clients(rec, rec->clients, rec->client_cnt);
+    for (int i = 0; i < rec->client_cnt; i++) {
+        close(rec->clients[i].sock);
+    }
+    rec->client_cnt = 0;
+
+    if (rec->has_ki) {
+        ALOGI("Kill '%s' (%d), uid %d, oom_score_adj %d to free %" PRId64 "kB rss, %" PRId64
+              "kB swap; reason: %s", rec->taskname, rec->pid, rec->uid, rec->oomadj, rec->rss_kb,
+              rec->swap_kb, rec->kill_desc);
+    } else {
+        ALOGI("Kill '%s' (%d), uid %d, oom_score_adj %d to free %" PRId64 "kB rss, %" PRId64
+              "kb swap", rec->taskname, rec->pid, rec->uid, rec->oomadj, rec->rss_kb,
+              rec->swap_kb);
+    }
+    killinfo_log(ctx, rec);
+}
+
+/*
+ * Collects the clients subscribed to kill reports. With dup_socks set their sockets are
+ * duplicated for the telemetry thread, so that the main thread can drop a connection while the
+ * report is queued. A client whose socket can't be duplicated is notified right away.
+ */
+static void kill_record_get_clients(struct kill_record *rec, bool dup_socks) {
+    struct kill_client now[MAX_DATA_CONN];
+    int now_cnt = 0;
+
+    rec->client_cnt = 0;
+    for (int i = 0; i < MAX_DATA_CONN; i++) {
+        uint32_t mask = data_sock[i].async_event_mask & KILL_REPORT_EVENTS;
+        int sock = data_sock[i].sock;
+
+        if (sock < 0 || !mask) {
+            continue;
         }
-        curr = curr->prev;
+        if (dup_socks) {
+            int dup_sock = fcntl(sock, F_DUPFD_CLOEXEC, 0);
+
+            if (dup_sock >= 0) {
+                rec->clients[rec->client_cnt++] = { dup_sock, mask };
+                continue;
+            }
+            ALOGE("Failed to duplicate data socket: %s", strerror(errno));
+        }
+        now[now_cnt++] = { sock, mask };
+    }
+    if (now_cnt > 0) {
+        report_kill_to_clients(rec, now, now_cnt);
     }
+}
 
-    return NULL;
+static void report_kill_drops(uint64_t dropped) {
+    ALOGW("%" PRIu64 " kill reports dropped, telemetry is falling behind", dropped);
 }
 
+static Telemetry telemetry(sizeof(struct kill_record), report_kill, report_kill_drops);
+/* record of a kill reported on the main thread, when telemetry is disabled or its ring is full */
+static struct kill_record sync_kill_record;
+
 // Can be called only from the main thread.
+static struct proc *proc_adj_tail(int oomadj) {
+    return (struct proc *)adjslot_tail(&procadjslot_list[ADJTOSLOT(oomadj)]);
+}
+
+/* Returns true if the process size was sampled within the trusted sample age */
+static bool proc_sample_fresh(struct proc *procp, struct timespec *tm) {
+    return procp->rss_pages >= 0 && proc_sample_interval_ms > 0 &&
+           get_time_diff_ms(&procp->sample_tm, tm) <=
+                   proc_sample_interval_ms * PROC_SAMPLE_MAX_AGE_INTERVALS;
+}
+
+/*
+ * Returns the RSS of the process in pages. Uses the size reported by the sampler thread unless it
+ * is missing or stale, in which case it is read from procfs.
+ */
+static int proc_get_cached_size(struct proc *procp, struct timespec *tm) {
+    if (proc_sample_fresh(procp, tm)) {
+        return procp->rss_pages;
+    }
+    return proc_get_size(procp->pid);
+}
+
+/*
+ * Returns true if a process can be killed based on the data cached in its record, without reading
+ * procfs first: the pidfd rules out pid reuse, the name was cached at registration and the size
+ * sample is recent.
+ */
+static bool proc_kill_data_cached(struct proc *procp, struct timespec *tm) {
+    return procp->pidfd >= 0 && procp->name != NameArena::INVALID_HANDLE &&
+           proc_sample_fresh(procp, tm);
+}
+
+/* Returns true if every registered process was sampled within the trusted sample age */
+static bool proc_samples_fresh(struct timespec *tm) {
+    return proc_sample_interval_ms > 0 && last_sample_round_tm.tv_sec > 0 &&
+           get_time_diff_ms(&last_sample_round_tm, tm) <=
+                   proc_sample_interval_ms * PROC_SAMPLE_MAX_AGE_INTERVALS;
+}
+
+/*
+ * The chosen process is verified against its live /proc/pid/status by kill_one_process() unless
+ * it is killed based on its cached data. Can be called only from the main thread.
+ */
 static struct proc *proc_get_heaviest(int oomadj) {
     struct adjslot_list *head = &procadjslot_list[ADJTOSLOT(oomadj)];
     struct adjslot_list *curr = head->next;
+    struct proc_heap *heap = &proc_heaps[ADJTOSLOT(oomadj)];
     struct proc *maxprocp = NULL;
     int maxsize = 0;
+    struct timespec curr_tm;
+
     if ((curr != head) && (curr->next == head)) {
         // Our list only has one process.  No need to access procfs for its size.
         return (struct proc *)curr;
     }
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &curr_tm);
+    /* When all sizes at this level are recent the heap top is the heaviest process */
+    if (heap->count > 0 && heap->unsampled == 0 && !heap->incomplete &&
+        proc_samples_fresh(&curr_tm)) {
+        return heap->procs[0];
+    }
     while (curr != head) {
         int pid = ((struct proc *)curr)->pid;
-        int tasksize = proc_get_size(pid);
+        int tasksize = proc_get_cached_size((struct proc *)curr, &curr_tm);
         if (tasksize < 0) {
             struct adjslot_list *next = curr->next;
             pid_remove(pid);
@@ -2256,53 +2929,163 @@ static struct proc *proc_get_heaviest(int oomadj) {
     return maxprocp;
 }
 
-static bool find_victim(int oom_score, int prev_pid, struct proc &target_proc) {
-    struct proc *procp;
-    std::shared_lock lock(adjslot_list_lock);
+/*
+ * Returns the anonymous memory the process has on the node in pages, or -1 if it is unknown.
+ * Read from memory.numa_stat of its per-app memcg, which lmkd can read unlike /proc/pid/numa_maps
+ * and which does not take the mmap lock of the process. The memcg holds only the app, so without
+ * per-app memcgs nothing is reported.
+ */
+static int64_t proc_get_node_anon(struct proc *procp, int node) {
+    std::string path;
+    char buf[pagesize];
+    char key[16];
+    const char *line;
+    const char *val;
+    int64_t anon;
+    bool in_bytes;
+    ssize_t size;
+    size_t pos;
+    int fd;
+
+    if (!per_app_memcg || !CgroupGetAttributePathForTask("MemStats", procp->pid, &path) ||
+        (pos = path.rfind('/')) == std::string::npos) {
+        return -1;
+    }
+    path.replace(pos + 1, std::string::npos, "memory.numa_stat");
+    if ((fd = open(path.c_str(), O_RDONLY | O_CLOEXEC)) < 0) {
+        return -1;
+    }
+    size = read_all(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (size <= 0) {
+        return -1;
+    }
+    buf[size] = '\0';
 
-    if (!prev_pid) {
-        procp = proc_adj_tail(oom_score);
+    /* cgroup v1 reports "anon=<pages> N0=<pages> ...", cgroup v2 "anon N0=<bytes> ..." */
+    if (!strncmp(buf, "anon", 4)) {
+        line = buf;
+    } else if ((line = strstr(buf, "\nanon")) != NULL) {
+        line++;
     } else {
-        procp = proc_adj_prev(oom_score, prev_pid);
-        if (!procp) {
-            // pid was removed, restart at the tail
-            procp = proc_adj_tail(oom_score);
-        }
+        return -1;
     }
-
-    // the list is empty at this oom_score or we looped through it
-    if (!procp || procp == proc_adj_head(oom_score)) {
-        return false;
+    if (line[4] != '=' && line[4] != ' ') {
+        return -1;
+    }
+    in_bytes = line[4] == ' ';
+    snprintf(key, sizeof(key), " N%d=", node);
+    if ((val = strstr(line, key)) == NULL || val > scan_line_end(line) ||
+        !scan_int64(val + strlen(key), &anon)) {
+        return -1;
     }
+    return in_bytes ? anon / pagesize : anon;
+}
+
+/*
+ * Returns the process at the oomadj level with the most anonymous memory on the node or NULL if
+ * none of them is known to have memory there. Can be called only from the main thread.
+ */
+static struct proc *proc_get_heaviest_on_node(int oomadj, int node) {
+    struct adjslot_list *head = &procadjslot_list[ADJTOSLOT(oomadj)];
+    struct proc *maxprocp = NULL;
+    int64_t maxpages = 0;
 
-    // make a copy because original might be destroyed after adjslot_list_lock is released
-    target_proc = *procp;
+    for (struct adjslot_list *curr = head->next; curr != head; curr = curr->next) {
+        struct proc *procp = (struct proc *)curr;
+        int64_t pages;
 
-    return true;
+        if (procp->valid && (pages = proc_get_node_anon(procp, node)) > maxpages) {
+            maxpages = pages;
+            maxprocp = procp;
+        }
+    }
+    return maxprocp;
 }
 
+/*
+ * Position of the watchdog in the published snapshot. A repeated timeout continues after the
+ * candidates already tried while the snapshot has not changed. Used only by the watchdog thread.
+ */
+static uint64_t watchdog_snapshot_gen;
+static bool watchdog_snapshot_seen;
+static size_t watchdog_cursor;
+
 static void watchdog_callback() {
-    int prev_pid = 0;
+    struct proc_snapshot *snapshot = proc_snapshot_acquire();
 
     ALOGW("lmkd watchdog timed out!");
-    for (int oom_score = OOM_SCORE_ADJ_MAX; oom_score >= 0;) {
-        struct proc target;
+    if (!watchdog_snapshot_seen || watchdog_snapshot_gen != snapshot->gen) {
+        watchdog_snapshot_gen = snapshot->gen;
+        watchdog_snapshot_seen = true;
+        watchdog_cursor = 0;
+    }
+    while (watchdog_cursor < snapshot->procs.size()) {
+        const struct proc_candidate& target = snapshot->procs[watchdog_cursor++];
 
-        if (!find_victim(oom_score, prev_pid, target)) {
-            oom_score--;
-            prev_pid = 0;
-            continue;
+        if (target.oomadj < 0) {
+            /* candidates are ordered by oomadj, the rest should not be killed either */
+            watchdog_cursor = snapshot->procs.size();
+            break;
         }
-
-        if (target.valid && reaper.kill({ target.pidfd, target.pid, target.uid }, true) == 0) {
-            ALOGW("lmkd watchdog killed process %d, oom_score_adj %d", target.pid, oom_score);
-            killinfo_log(&target, 0, 0, 0, NULL, NULL, NULL, NULL, NULL);
-            // Can't call pid_remove() from non-main thread, therefore just invalidate the record
-            pid_invalidate(target.pid);
+        if (reaper.kill({ target.pidfd, target.pid, target.uid }, true) == 0) {
+            struct kill_record killed = {};
+
+            killed.pid = target.pid;
+            killed.uid = target.uid;
+            killed.oomadj = target.oomadj;
+            ALOGW("lmkd watchdog killed process %d, oom_score_adj %d", target.pid, target.oomadj);
+            // The main thread is stuck and can't report the kill, log it from this thread
+            killinfo_log(watchdog_ctx, &killed);
+            // Can't call pid_remove() from non-main thread, ask the main thread to invalidate
+            // the record
+            if (TEMP_FAILURE_RETRY(write(watchdog_comm_fd[1], &target.pid, sizeof(target.pid))) !=
+                sizeof(target.pid)) {
+                ALOGE("watchdog communication write failed: %s", strerror(errno));
+            }
             break;
         }
-        prev_pid = target.pid;
     }
+    proc_snapshot_release(snapshot);
+}
+
+static void watchdog_kill_handler(int data __unused, uint32_t events __unused,
+                                  struct polling_params *poll_params __unused) {
+    int pid;
+
+    if (TEMP_FAILURE_RETRY(read(watchdog_comm_fd[0], &pid, sizeof(pid))) != sizeof(pid)) {
+        ALOGE("watchdog communication read failed: %s", strerror(errno));
+        return;
+    }
+    pid_invalidate(pid);
+}
+
+static bool init_watchdog_comm() {
+    static struct event_handler_info watchdog_hinfo = { 0, watchdog_kill_handler };
+    struct epoll_event epev;
+
+    if (pipe2(watchdog_comm_fd, O_CLOEXEC)) {
+        ALOGE("pipe failed: %s", strerror(errno));
+        return false;
+    }
+    // Ensure main thread never blocks on read
+    if (fcntl(watchdog_comm_fd[0], F_SETFL, fcntl(watchdog_comm_fd[0], F_GETFL) | O_NONBLOCK)) {
+        ALOGE("fcntl failed: %s", strerror(errno));
+        goto err;
+    }
+    epev.events = EPOLLIN;
+    epev.data.ptr = (void *)&watchdog_hinfo;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, watchdog_comm_fd[0], &epev)) {
+        ALOGE("epoll_ctl failed: %s", strerror(errno));
+        goto err;
+    }
+    maxevents++;
+    return true;
+
+err:
+    close(watchdog_comm_fd[0]);
+    close(watchdog_comm_fd[1]);
+    return false;
 }
 
 static Watchdog watchdog(WATCHDOG_TIMEOUT_SEC, watchdog_callback);
@@ -2310,7 +3093,7 @@ static Watchdog watchdog(WATCHDOG_TIMEOUT_SEC, watchdog_callback);
 static bool is_kill_pending(void) {
     char buf[24];
 
-    if (last_kill_pid_or_fd < 0) {
+    if (kill_wait_cnt == 0) {
         return false;
     }
 
@@ -2319,62 +3102,131 @@ static bool is_kill_pending(void) {
     }
 
     /* when pidfd is not supported base the decision on /proc/<pid> existence */
-    snprintf(buf, sizeof(buf), "/proc/%d/", last_kill_pid_or_fd);
-    if (access(buf, F_OK) == 0) {
-        return true;
+    for (const struct kill_wait& kw : kill_waits) {
+        if (kw.pid == 0) {
+            continue;
+        }
+        snprintf(buf, sizeof(buf), "/proc/%d/", kw.pid_or_fd);
+        if (procfs_access(buf, F_OK) == 0) {
+            return true;
+        }
     }
 
     return false;
 }
 
 static bool is_waiting_for_kill(void) {
-    return pidfd_supported && last_kill_pid_or_fd >= 0;
+    return pidfd_supported && kill_wait_cnt > 0;
 }
 
-static void stop_wait_for_proc_kill(bool finished) {
+static bool is_waiting_for_fd(int fd) {
+    if (!pidfd_supported) {
+        return false;
+    }
+    for (const struct kill_wait& kw : kill_waits) {
+        if (kw.pid != 0 && kw.pid_or_fd == fd) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Stops waiting for a kill. finished is set if the process is known to be dead, in which case the
+ * time it took to die is recorded.
+ */
+static void kill_wait_remove(struct kill_wait *kw, bool finished) {
     struct epoll_event epev;
+    struct timespec curr_tm;
+    long latency_ms;
 
-    if (last_kill_pid_or_fd < 0) {
-        return;
+    if (clock_gettime(CLOCK_MONOTONIC_COARSE, &curr_tm) != 0) {
+        /*
+         * curr_tm is used here merely to report kill duration, so this failure is not fatal.
+         * Log an error and continue.
+         */
+        ALOGE("Failed to get current time");
+    }
+    latency_ms = get_time_diff_ms(&kw->start_tm, &curr_tm);
+    if (finished) {
+        trace_kill_latency(latency_ms);
     }
-
     if (debug_process_killing) {
-        struct timespec curr_tm;
-
-        if (clock_gettime(CLOCK_MONOTONIC_COARSE, &curr_tm) != 0) {
-            /*
-             * curr_tm is used here merely to report kill duration, so this failure is not fatal.
-             * Log an error and continue.
-             */
-            ALOGE("Failed to get current time");
-        }
-
         if (finished) {
-            ALOGI("Process got killed in %ldms",
-                get_time_diff_ms(&last_kill_tm, &curr_tm));
+            ALOGI("Process %d got killed in %ldms, %" PRId64 "kB expected to be freed", kw->pid,
+                  latency_ms, (int64_t)kw->pages * page_k);
         } else {
-            ALOGI("Stop waiting for process kill after %ldms",
-                get_time_diff_ms(&last_kill_tm, &curr_tm));
+            ALOGI("Stop waiting for process %d kill after %ldms", kw->pid, latency_ms);
         }
     }
 
     if (pidfd_supported) {
         /* unregister fd */
-        if (epoll_ctl(epollfd, EPOLL_CTL_DEL, last_kill_pid_or_fd, &epev)) {
+        if (epoll_ctl(epollfd, EPOLL_CTL_DEL, kw->pid_or_fd, &epev)) {
             // Log an error and keep going
             ALOGE("epoll_ctl for last killed process failed; errno=%d", errno);
         }
         maxevents--;
-        close(last_kill_pid_or_fd);
+        /* the pidfd belongs to a process record and might be in the published snapshot */
+        pidfd_close_deferred(kw->pid_or_fd);
+    }
+
+    kw->pid = 0;
+    kw->pid_or_fd = -1;
+    kill_wait_cnt--;
+}
+
+static void stop_wait_for_proc_kill(bool finished) {
+    for (struct kill_wait& kw : kill_waits) {
+        if (kw.pid != 0) {
+            kill_wait_remove(&kw, finished);
+        }
+    }
+}
+
+/* Stops waiting for one process. Returns true if other kills are still in flight. */
+static bool stop_wait_for_pid(int pid, bool finished) {
+    for (struct kill_wait& kw : kill_waits) {
+        if (kw.pid != 0 && kw.pid == pid) {
+            kill_wait_remove(&kw, finished);
+            break;
+        }
+    }
+    return kill_wait_cnt > 0;
+}
+
+/* Returns the time left until the oldest in-flight kill times out */
+static long kill_wait_timeout_ms(struct timespec *tm) {
+    long timeout_ms = kill_timeout_ms;
+
+    for (struct kill_wait& kw : kill_waits) {
+        if (kw.pid != 0) {
+            timeout_ms = std::min(timeout_ms, static_cast<long>(kill_timeout_ms) -
+                                                      get_time_diff_ms(&kw.start_tm, tm));
+        }
     }
+    return std::max(timeout_ms, 0L);
+}
 
-    last_kill_pid_or_fd = -1;
+/* Stops waiting for the kills which did not complete within kill_timeout_ms */
+static void stop_wait_for_expired_kills(struct timespec *tm) {
+    for (struct kill_wait& kw : kill_waits) {
+        if (kw.pid != 0 &&
+            get_time_diff_ms(&kw.start_tm, tm) >= static_cast<long>(kill_timeout_ms)) {
+            kill_wait_remove(&kw, false);
+        }
+    }
 }
 
-static void kill_done_handler(int data __unused, uint32_t events __unused,
+static void kill_done_handler(int data, uint32_t events __unused,
                               struct polling_params *poll_params) {
-    stop_wait_for_proc_kill(true);
-    poll_params->update = POLLING_RESUME;
+    /* the wait might have been stopped after this event was returned */
+    if (kill_waits[data].pid == 0) {
+        return;
+    }
+    if (!stop_wait_for_pid(kill_waits[data].pid, true)) {
+        poll_params->update = POLLING_RESUME;
+    }
 }
 
 static void kill_fail_handler(int data __unused, uint32_t events __unused,
@@ -2385,82 +3237,117 @@ static void kill_fail_handler(int data __unused, uint32_t events __unused,
     // epoll_wait calls to sleep until the next event.
     if (TEMP_FAILURE_RETRY(read(reaper_comm_fd[0], &pid, sizeof(pid))) != sizeof(pid)) {
         ALOGE("thread communication read failed: %s", strerror(errno));
+        pid = 0;
+    }
+    if (!stop_wait_for_pid(pid, false)) {
+        poll_params->update = POLLING_RESUME;
     }
-    stop_wait_for_proc_kill(false);
-    poll_params->update = POLLING_RESUME;
 }
 
-static void start_wait_for_proc_kill(int pid_or_fd) {
-    static struct event_handler_info kill_done_hinfo = { 0, kill_done_handler };
+/* Returns the number of kills which can be waited for in addition to the kills in flight */
+static int kill_wait_free_slots() {
+    return MAX_KILL_WAIT - kill_wait_cnt;
+}
+
+/*
+ * Starts waiting for a killed process to die, in addition to the kills already in flight. pages is
+ * the size the kill is expected to free.
+ */
+static void start_wait_for_proc_kill(int pid, int pidfd, int pages) {
+    static struct event_handler_info kill_done_hinfo[MAX_KILL_WAIT];
     struct epoll_event epev;
+    int i;
 
-    if (last_kill_pid_or_fd >= 0) {
-        /* Should not happen but if it does we should stop previous wait */
-        ALOGE("Attempt to wait for a kill while another wait is in progress");
-        stop_wait_for_proc_kill(false);
+    for (i = 0; i < MAX_KILL_WAIT && kill_waits[i].pid != 0; i++) {}
+    if (i == MAX_KILL_WAIT) {
+        ALOGE("Too many process kills in flight, not waiting for %d", pid);
+        return;
     }
 
-    last_kill_pid_or_fd = pid_or_fd;
-
-    if (!pidfd_supported) {
-        /* If pidfd is not supported just store PID and exit */
-        return;
+    if (pidfd_supported) {
+        kill_done_hinfo[i] = { i, kill_done_handler };
+        epev.events = EPOLLIN;
+        epev.data.ptr = (void *)&kill_done_hinfo[i];
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pidfd, &epev) != 0) {
+            ALOGE("epoll_ctl for last kill failed; errno=%d", errno);
+            return;
+        }
+        maxevents++;
     }
 
-    epev.events = EPOLLIN;
-    epev.data.ptr = (void *)&kill_done_hinfo;
-    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, last_kill_pid_or_fd, &epev) != 0) {
-        ALOGE("epoll_ctl for last kill failed; errno=%d", errno);
-        close(last_kill_pid_or_fd);
-        last_kill_pid_or_fd = -1;
-        return;
+    if (clock_gettime(CLOCK_MONOTONIC_COARSE, &kill_waits[i].start_tm) != 0) {
+        ALOGE("Failed to get current time");
     }
-    maxevents++;
+    kill_waits[i].pid = pid;
+    kill_waits[i].pid_or_fd = pidfd_supported ? pidfd : pid;
+    kill_waits[i].pages = pages;
+    kill_wait_cnt++;
 }
 
-/* Kill one process specified by procp.  Returns the size (in pages) of the process killed */
+/*
+ * Kill one process specified by procp.  Returns the size (in pages) of the process killed.
+ */
 static int kill_one_process(struct proc* procp, int min_oom_score, struct kill_info *ki,
                             union meminfo *mi, struct wakeup_info *wi, struct timespec *tm,
                             struct psi_data *pd) {
     int pid = procp->pid;
     int pidfd = procp->pidfd;
     uid_t uid = procp->uid;
-    char *taskname;
+    const char *taskname;
     int kill_result;
     int result = -1;
     struct memory_stat *mem_st;
-    struct kill_stat kill_st;
+    struct kill_record *rec;
+    bool queued;
     int64_t tgid;
     int64_t rss_kb;
     int64_t swap_kb;
     char buf[pagesize];
     char desc[LINE_MAX];
 
-    if (!procp->valid || !read_proc_status(pid, buf, sizeof(buf))) {
-        goto out;
-    }
-    if (!parse_status_tag(buf, PROC_STATUS_TGID_FIELD, &tgid)) {
-        ALOGE("Unable to parse tgid from /proc/%d/status", pid);
-        goto out;
-    }
-    if (tgid != pid) {
-        ALOGE("Possible pid reuse detected (pid %d, tgid %" PRId64 ")!", pid, tgid);
-        goto out;
-    }
-    // Zombie processes will not have RSS / Swap fields.
-    if (!parse_status_tag(buf, PROC_STATUS_RSS_FIELD, &rss_kb)) {
-        goto out;
-    }
-    if (!parse_status_tag(buf, PROC_STATUS_SWAP_FIELD, &swap_kb)) {
+    if (!procp->valid) {
         goto out;
     }
 
-    taskname = proc_get_name(pid, buf, sizeof(buf));
-    // taskname will point inside buf, do not reuse buf onwards.
-    if (!taskname) {
-        goto out;
+    if (kill_signal_first && proc_kill_data_cached(procp, tm)) {
+        /*
+         * No /proc/pid/status check for pid reuse is needed: pidfds are opened only for thread
+         * group leaders and can't signal a different process once the registered one is gone.
+         */
+        taskname = proc_cached_name(procp);
+        rss_kb = procp->rss_pages * page_k;
+        swap_kb = procp->swap_pages * page_k;
+    } else {
+        if (!read_proc_status(pid, buf, sizeof(buf))) {
+            goto out;
+        }
+        if (!parse_status_tag(buf, PROC_STATUS_TGID_FIELD, &tgid)) {
+            ALOGE("Unable to parse tgid from /proc/%d/status", pid);
+            goto out;
+        }
+        if (tgid != pid) {
+            ALOGE("Possible pid reuse detected (pid %d, tgid %" PRId64 ")!", pid, tgid);
+            goto out;
+        }
+        // Zombie processes will not have RSS / Swap fields.
+        if (!parse_status_tag(buf, PROC_STATUS_RSS_FIELD, &rss_kb)) {
+            goto out;
+        }
+        if (!parse_status_tag(buf, PROC_STATUS_SWAP_FIELD, &swap_kb)) {
+            goto out;
+        }
+
+        taskname = proc_get_name(pid, buf, sizeof(buf));
+        if (!taskname) {
+            taskname = proc_cached_name(procp);
+        }
+        // taskname might point inside buf, do not reuse buf onwards.
+        if (!taskname) {
+            goto out;
+        }
     }
 
+    /* read while the process and its memcg are still around, the report is sent after the kill */
     mem_st = stats_read_memory_stat(per_app_memcg, pid, uid, rss_kb * 1024, swap_kb * 1024);
 
     snprintf(desc, sizeof(desc), "lmk,%d,%d,%d,%d,%d", pid, ki ? (int)ki->kill_reason : -1,
@@ -2479,47 +3366,81 @@ static int kill_one_process(struct proc* procp, int min_oom_score, struct kill_i
 
     trace_kill_start(desc);
 
-    start_wait_for_proc_kill(pidfd < 0 ? pid : pidfd);
+    start_wait_for_proc_kill(pid, pidfd, rss_kb / page_k);
     kill_result = reaper.kill({ pidfd, pid, uid }, false);
 
     trace_kill_end();
 
     if (kill_result) {
-        stop_wait_for_proc_kill(false);
+        stop_wait_for_pid(pid, false);
         ALOGE("kill(%d): errno=%d", pid, errno);
         /* Delete process record even when we fail to kill so that we don't get stuck on it */
         goto out;
     }
 
-    last_kill_tm = *tm;
+    if (debug_process_killing) {
+        struct timespec signal_tm;
+
+        clock_gettime(CLOCK_MONOTONIC, &signal_tm);
+        ALOGI("Kill signal for %d sent %ldus after the event", pid,
+              get_time_diff_us(&handler_start_tm, &signal_tm));
+    }
 
-    inc_killcnt(procp->oomadj);
+    last_kill_tm = *tm;
 
+    inc_killcnt(procp->oomadj, ki ? ki->kill_reason : NONE);
+
+    /* the record is built in its ring slot, which is only read once it is committed */
+    rec = telemetry.is_enabled() ? static_cast<struct kill_record*>(telemetry.reserve()) : NULL;
+    queued = rec != NULL;
+    if (!queued) {
+        rec = &sync_kill_record;
+    }
+    rec->pid = pid;
+    rec->uid = uid;
+    rec->oomadj = procp->oomadj;
+    rec->min_oom_score = min_oom_score;
+    rec->rss_kb = rss_kb;
+    rec->swap_kb = swap_kb;
+    strlcpy(rec->taskname, taskname, sizeof(rec->taskname));
+    rec->has_ki = ki != NULL;
     if (ki) {
-        kill_st.kill_reason = ki->kill_reason;
-        kill_st.thrashing = ki->thrashing;
-        kill_st.max_thrashing = ki->max_thrashing;
-        ALOGI("Kill '%s' (%d), uid %d, oom_score_adj %d to free %" PRId64 "kB rss, %" PRId64
-              "kB swap; reason: %s", taskname, pid, uid, procp->oomadj, rss_kb, swap_kb,
-              ki->kill_desc);
-    } else {
-        kill_st.kill_reason = NONE;
-        kill_st.thrashing = 0;
-        kill_st.max_thrashing = 0;
-        ALOGI("Kill '%s' (%d), uid %d, oom_score_adj %d to free %" PRId64 "kB rss, %" PRId64
-              "kb swap", taskname, pid, uid, procp->oomadj, rss_kb, swap_kb);
+        rec->kill_reason = ki->kill_reason;
+        rec->thrashing = ki->thrashing;
+        rec->max_thrashing = ki->max_thrashing;
+        strlcpy(rec->kill_desc, ki->kill_desc, sizeof(rec->kill_desc));
+    }
+    rec->has_mi = true;
+    rec->mi = *mi;
+    rec->has_wi = wi != NULL;
+    if (wi) {
+        rec->wi = *wi;
+    }
+    rec->tm = *tm;
+    rec->has_pd = pd != NULL;
+    if (pd) {
+        rec->pd = *pd;
+    }
+    rec->free_mem_kb = mi->field.nr_free_pages * page_k;
+    rec->free_swap_kb = get_free_swap(mi) * page_k;
+    rec->has_mem_st = mem_st != NULL;
+    if (mem_st) {
+        rec->mem_st = *mem_st;
     }
-    killinfo_log(procp, min_oom_score, rss_kb, swap_kb, ki, mi, wi, tm, pd);
-
-    kill_st.uid = static_cast<int32_t>(uid);
-    kill_st.taskname = taskname;
-    kill_st.oom_score = procp->oomadj;
-    kill_st.min_oom_score = min_oom_score;
-    kill_st.free_mem_kb = mi->field.nr_free_pages * page_k;
-    kill_st.free_swap_kb = get_free_swap(mi) * page_k;
-    stats_write_lmk_kill_occurred(&kill_st, mem_st);
 
-    ctrl_data_write_lmk_kill_occurred((pid_t)pid, uid, rss_kb);
+    /*
+     * Socket writes and logging are left to the telemetry thread unless it is not running. With a
+     * full ring the clients are still notified from here and only the log is dropped and counted.
+     */
+    if (queued) {
+        kill_record_get_clients(rec, true);
+        telemetry.commit();
+    } else {
+        kill_record_get_clients(rec, false);
+        if (!telemetry.is_enabled()) {
+            report_kill(rec);
+        }
+    }
 
     result = rss_kb / page_k;
 
@@ -2533,41 +3454,226 @@ out:
 }
 
 /*
- * Find one process to kill at or above the given oom_score_adj level.
- * Returns size of the killed process.
+ * Kill the other processes of an app uid at or above the oomadj level of its process just killed,
+ * so that a multi-process app is killed at once instead of one process per kill cycle. The kills
+ * are dispatched to the reaper together and all of them are waited for, so at most max_kills
+ * processes are killed. Returns the size of the killed processes.
+ */
+static int kill_uid_procs(uid_t uid, int min_oomadj, int min_score_adj, int max_kills,
+                          struct kill_info *ki, union meminfo *mi, struct wakeup_info *wi,
+                          struct timespec *tm, struct psi_data *pd) {
+    struct adjslot_list *head = &uidhash[uid_hashfn(uid)];
+    struct adjslot_list *curr;
+    int pids[MAX_KILL_WAIT - 1];
+    int pid_cnt = 0;
+    int killed_size = 0;
+
+    /* processes of system uids are not related apps */
+    if (uid % AID_USER_OFFSET < AID_APP_START) {
+        return 0;
+    }
+    max_kills = std::min(max_kills, MAX_KILL_WAIT - 1);
+
+    /* collect pids first, kill_one_process() removes records from the list */
+    for (curr = head->next; curr != head; curr = curr->next) {
+        struct proc *procp = uid_list_to_proc(curr);
+
+        if (procp->uid != uid || procp->oomadj < min_oomadj || !procp->valid) {
+            continue;
+        }
+        if (pid_cnt >= max_kills) {
+            ALOGW("Too many processes of uid %d, killing only %d at once", uid, pid_cnt);
+            break;
+        }
+        pids[pid_cnt++] = procp->pid;
+    }
+
+    for (int i = 0; i < pid_cnt; i++) {
+        struct proc *procp = pid_lookup(pids[i]);
+        int size;
+
+        if (procp && (size = kill_one_process(procp, min_score_adj, ki, mi, wi, tm, pd)) > 0) {
+            killed_size += size;
+        }
+    }
+
+    return killed_size;
+}
+
+/*
+ * Find one process to kill at or above the given oom_score_adj level.
+ * If a node is starved, processes with memory on that node are preferred within each level.
+ * Returns size of the killed process.
+ */
+static int find_and_kill_process(int min_score_adj, struct kill_info *ki, union meminfo *mi,
+                                 struct wakeup_info *wi, struct timespec *tm,
+                                 struct psi_data *pd) {
+    int i;
+    int killed_size = 0;
+    int victim_pid = 0;
+    uid_t victim_uid = 0;
+    bool choose_heaviest_task = kill_heaviest_task;
+
+    /* skip levels without processes */
+    for (i = proc_adj_prev_occupied(OOM_SCORE_ADJ_MAX); i >= min_score_adj;
+         i = proc_adj_prev_occupied(i - 1)) {
+        struct proc *procp;
+
+        if (!choose_heaviest_task && i <= PERCEPTIBLE_APP_ADJ) {
+            /*
+             * If we have to choose a perceptible process, choose the heaviest one to
+             * hopefully minimize the number of victims.
+             */
+            choose_heaviest_task = true;
+        }
+
+        while (true) {
+            procp = NULL;
+            /*
+             * Levels are still visited in order, a process which frees memory on the starved node
+             * is preferred within a level
+             */
+            if (ki && ki->starved_node >= 0) {
+                procp = proc_get_heaviest_on_node(i, ki->starved_node);
+            }
+            if (!procp) {
+                procp = choose_heaviest_task ? proc_get_heaviest(i) : proc_adj_tail(i);
+            }
+
+            if (!procp)
+                break;
+
+            victim_pid = procp->pid;
+            victim_uid = procp->uid;
+            killed_size = kill_one_process(procp, min_score_adj, ki, mi, wi, tm, pd);
+            if (killed_size >= 0) {
+                break;
+            }
+        }
+        if (killed_size) {
+            break;
+        }
+    }
+
+    /* the record is left in place if the kill was skipped because memory was freed elsewhere */
+    if (killed_size > 0 && kill_uid_group && !pid_lookup(victim_pid)) {
+        killed_size += kill_uid_procs(victim_uid, i, min_score_adj, kill_wait_free_slots(), ki,
+                                      mi, wi, tm, pd);
+    }
+
+    return killed_size;
+}
+
+/*
+ * Estimates the pages freed by killing a process from its sampled RSS and swap usage. Returns -1
+ * if the process was not sampled recently, procfs is not read here.
+ */
+static int proc_estimate_freed(struct proc *procp, struct timespec *tm) {
+    if (!proc_sample_fresh(procp, tm)) {
+        return -1;
+    }
+    return procp->rss_pages + procp->swap_pages;
+}
+
+/*
+ * Plans the kills needed to free target_pages at or above min_score_adj. Levels are visited from
+ * the highest oom_score_adj down and the heaviest processes of a level are picked first, which
+ * keeps the set small without sparing less important processes. Stores the pids of up to
+ * max_victims processes into pids and returns their count.
+ */
+static int plan_kills(int min_score_adj, int64_t target_pages, struct timespec *tm, int *pids,
+                      int max_victims) {
+    int64_t planned_pages = 0;
+    int cnt = 0;
+
+    for (int i = proc_adj_prev_occupied(OOM_SCORE_ADJ_MAX);
+         i >= min_score_adj && cnt < max_victims && planned_pages < target_pages;
+         i = proc_adj_prev_occupied(i - 1)) {
+        struct adjslot_list *head = &procadjslot_list[ADJTOSLOT(i)];
+        struct proc *top[MAX_KILL_WAIT];
+        int top_size[MAX_KILL_WAIT];
+        int top_cnt = 0;
+        int top_max = max_victims - cnt;
+
+        /* keep the heaviest processes of the level sorted by size */
+        for (struct adjslot_list *curr = head->next; curr != head; curr = curr->next) {
+            struct proc *procp = (struct proc *)curr;
+            int size;
+            int j;
+
+            if (!procp->valid || (size = proc_estimate_freed(procp, tm)) < 0) {
+                continue;
+            }
+            if (top_cnt == top_max && size <= top_size[top_cnt - 1]) {
+                continue;
+            }
+            if (top_cnt < top_max) {
+                top_cnt++;
+            }
+            for (j = top_cnt - 1; j > 0 && top_size[j - 1] < size; j--) {
+                top[j] = top[j - 1];
+                top_size[j] = top_size[j - 1];
+            }
+            top[j] = procp;
+            top_size[j] = size;
+        }
+
+        for (int j = 0; j < top_cnt && planned_pages < target_pages; j++) {
+            pids[cnt++] = top[j]->pid;
+            planned_pages += top_size[j];
+        }
+    }
+
+    if (debug_process_killing) {
+        ALOGI("Planned %d kill(s) to free %" PRId64 "kB out of %" PRId64 "kB", cnt,
+              planned_pages * page_k, target_pages * page_k);
+    }
+    return cnt;
+}
+
+/*
+ * Kills the processes planned to free target_pages at once, so that a fast allocation spike is
+ * handled in a single kill cycle instead of one kill per kill_timeout_ms. The kills are dispatched
+ * to the reaper together and all of them are waited for. Planning relies on the sampled sizes,
+ * reading the size of every candidate would cost more than the kills save, so nothing is killed
+ * unless all processes were sampled recently. Returns the size of the killed processes.
  */
-static int find_and_kill_process(int min_score_adj, struct kill_info *ki, union meminfo *mi,
-                                 struct wakeup_info *wi, struct timespec *tm,
-                                 struct psi_data *pd) {
-    int i;
+static int kill_planned_processes(int min_score_adj, int64_t target_pages, struct kill_info *ki,
+                                  union meminfo *mi, struct wakeup_info *wi, struct timespec *tm,
+                                  struct psi_data *pd) {
+    int pids[MAX_KILL_WAIT];
+    int pid_cnt;
     int killed_size = 0;
-    bool choose_heaviest_task = kill_heaviest_task;
-
-    for (i = OOM_SCORE_ADJ_MAX; i >= min_score_adj; i--) {
-        struct proc *procp;
-
-        if (!choose_heaviest_task && i <= PERCEPTIBLE_APP_ADJ) {
-            /*
-             * If we have to choose a perceptible process, choose the heaviest one to
-             * hopefully minimize the number of victims.
-             */
-            choose_heaviest_task = true;
-        }
 
-        while (true) {
-            procp = choose_heaviest_task ?
-                proc_get_heaviest(i) : proc_adj_tail(i);
+    if (!proc_samples_fresh(tm)) {
+        return 0;
+    }
+    /* every kill takes a kill_waits slot until the process dies */
+    pid_cnt = plan_kills(min_score_adj, target_pages, tm, pids,
+                         std::min(kill_plan_max_victims, kill_wait_free_slots()));
 
-            if (!procp)
-                break;
+    /* look the records up again, killing a uid group might have removed some of them */
+    for (int i = 0; i < pid_cnt; i++) {
+        struct proc *procp = pid_lookup(pids[i]);
+        int oomadj;
+        uid_t uid;
+        int size;
 
-            killed_size = kill_one_process(procp, min_score_adj, ki, mi, wi, tm, pd);
-            if (killed_size >= 0) {
-                break;
-            }
+        if (!procp) {
+            continue;
         }
-        if (killed_size) {
-            break;
+        oomadj = procp->oomadj;
+        uid = procp->uid;
+        size = kill_one_process(procp, min_score_adj, ki, mi, wi, tm, pd);
+        if (size <= 0) {
+            continue;
+        }
+        killed_size += size;
+        if (kill_uid_group && !pid_lookup(pids[i])) {
+            /* leave the slots of the remaining planned victims free */
+            killed_size += kill_uid_procs(uid, oomadj, min_score_adj,
+                                          kill_wait_free_slots() - (pid_cnt - i - 1), ki, mi, wi,
+                                          tm, pd);
         }
     }
 
@@ -2646,13 +3752,92 @@ struct zone_watermarks {
 static struct zone_watermarks watermarks;
 
 /*
- * Returns lowest breached watermark or WMARK_NONE.
+ * Per-node state used on multi-node (NUMA) systems, where a single exhausted node can be hidden
+ * by the system-wide totals. Populated once during init.
  */
-static enum zone_watermark get_lowest_watermark(union meminfo *mi,
-                                                struct zone_watermarks *watermarks)
-{
-    int64_t nr_free_pages = mi->field.nr_free_pages - mi->field.cma_free;
+struct node_info {
+    int id;
+    struct reread_data meminfo_data;
+    struct zone_watermarks watermarks;
+    int64_t nr_free_pages;
+};
+
+static std::vector<struct node_info> nodes;
+
+static struct node_info *node_info_find(int node_id) {
+    for (auto& node : nodes) {
+        if (node.id == node_id) {
+            return &node;
+        }
+    }
+    return NULL;
+}
+
+/* Per-node tracking is opt-in and only enabled when there is more than one node */
+static bool per_node_tracking() {
+    return per_node_watermarks && nodes.size() > 1;
+}
+
+static void init_node_info() {
+    DIR *dir;
+    struct dirent *de;
+    char path[PATH_MAX];
+    char *filename;
+    int node_id;
+
+    if (!per_node_watermarks) {
+        return;
+    }
+    if ((dir = procfs_opendir(NODE_SYSFS_DIR)) == NULL) {
+        /* kernel without NUMA support */
+        return;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        if (sscanf(de->d_name, "node%d", &node_id) != 1) {
+            continue;
+        }
+        snprintf(path, sizeof(path), NODE_MEMINFO_PATH_FMT, node_id);
+        /* nodes are never removed, the filename lives until lmkd exits */
+        if ((filename = strdup(path)) == NULL) {
+            ALOGE("Failed to allocate memory for node %d", node_id);
+            continue;
+        }
+        nodes.push_back({
+            .id = node_id,
+            .meminfo_data = {
+                .filename = filename,
+                .fd = -1,
+            },
+        });
+    }
+    closedir(dir);
+
+    if (per_node_tracking()) {
+        ALOGI("Tracking watermarks of %zu memory nodes", nodes.size());
+    }
+}
+
+/* Reads free pages of the node from "Node <id> MemFree: <value> kB" line of the node meminfo */
+static int node_meminfo_parse(struct node_info *node) {
+    char *buf;
+    const char *pos;
+    int64_t free_kb;
+
+    if ((buf = reread_file(&node->meminfo_data)) == NULL) {
+        return -1;
+    }
+    if ((pos = strstr(buf, NODE_MEMINFO_FREE_FIELD)) == NULL ||
+        !scan_int64(pos + strlen(NODE_MEMINFO_FREE_FIELD), &free_kb)) {
+        ALOGE("%s parse error", node->meminfo_data.filename);
+        return -1;
+    }
+    node->nr_free_pages = free_kb / page_k;
+    return 0;
+}
 
+static enum zone_watermark get_lowest_free_watermark(int64_t nr_free_pages,
+                                                     struct zone_watermarks *watermarks)
+{
     if (nr_free_pages < watermarks->min_wmark) {
         return WMARK_MIN;
     }
@@ -2665,31 +3850,207 @@ static enum zone_watermark get_lowest_watermark(union meminfo *mi,
     return WMARK_NONE;
 }
 
-void calc_zone_watermarks(struct zoneinfo *zi, struct zone_watermarks *watermarks) {
+/*
+ * Returns lowest breached watermark or WMARK_NONE.
+ */
+static enum zone_watermark get_lowest_watermark(union meminfo *mi,
+                                                struct zone_watermarks *watermarks)
+{
+    return get_lowest_free_watermark(mi->field.nr_free_pages - mi->field.cma_free, watermarks);
+}
+
+/*
+ * Returns the number of pages to free to get free memory back above the high watermark and free
+ * swap above swap_low_threshold, whichever is larger.
+ */
+static int64_t get_reclaim_target(union meminfo *mi, int64_t swap_low_threshold) {
+    int64_t target = watermarks.high_wmark - (mi->field.nr_free_pages - mi->field.cma_free);
+
+    if (swap_low_threshold > 0) {
+        target = std::max(target, swap_low_threshold - get_free_swap(mi));
+    }
+    return std::max(target, (int64_t)0);
+}
+
+/*
+ * Returns the lowest watermark breached by any node and stores that node id into starved_node,
+ * or returns WMARK_NONE and sets starved_node to -1. Per-node free pages include CMA pages
+ * because node meminfo does not report them separately.
+ */
+static enum zone_watermark get_lowest_node_watermark(int *starved_node) {
+    enum zone_watermark lowest = WMARK_NONE;
+
+    *starved_node = -1;
+    for (auto& node : nodes) {
+        enum zone_watermark wmark;
+
+        if (node_meminfo_parse(&node) < 0) {
+            continue;
+        }
+        wmark = get_lowest_free_watermark(node.nr_free_pages, &node.watermarks);
+        if (wmark < lowest) {
+            lowest = wmark;
+            *starved_node = node.id;
+        }
+    }
+    return lowest;
+}
+
+/* zoneinfo per-zone fields needed for watermark calculation */
+enum zoneinfo_wmark_field {
+    ZI_WMARK_MIN = 0,
+    ZI_WMARK_LOW,
+    ZI_WMARK_HIGH,
+    ZI_WMARK_PRESENT,
+    ZI_WMARK_PROTECTION,
+    ZI_WMARK_PAGESETS,
+    ZI_WMARK_FIELD_COUNT
+};
+
+static constexpr const char* zoneinfo_wmark_field_names[ZI_WMARK_FIELD_COUNT] = {
+    "min",
+    "low",
+    "high",
+    "present",
+    "protection:",
+    "pagesets",
+};
+
+static constexpr field_index<ZI_WMARK_FIELD_COUNT> zoneinfo_wmark_field_index(
+        zoneinfo_wmark_field_names);
+
+static int64_t zoneinfo_max_protection(const char *str, const char *end) {
+    int64_t max = 0;
+    int64_t val;
+
+    /* "(<value>, <value>, ...)" */
+    while (str < end) {
+        if ((unsigned char)(*str - '0') > 9) {
+            str++;
+            continue;
+        }
+        if (!(str = scan_int64(str, &val))) {
+            break;
+        }
+        max = std::max(max, val);
+    }
+    return max;
+}
+
+static void add_zone_watermarks(const int64_t *fields, struct zone_watermarks *watermarks) {
+    int64_t max_protection = fields[ZI_WMARK_PROTECTION];
+
+    watermarks->high_wmark += max_protection + fields[ZI_WMARK_HIGH];
+    watermarks->low_wmark += max_protection + fields[ZI_WMARK_LOW];
+    watermarks->min_wmark += max_protection + fields[ZI_WMARK_MIN];
+}
+
+static void zoneinfo_add_zone_watermarks(const int64_t *fields, struct zone_watermarks *watermarks,
+                                         struct node_info *node) {
+    if (!fields[ZI_WMARK_PRESENT]) {
+        return;
+    }
+
+    add_zone_watermarks(fields, watermarks);
+    if (node) {
+        add_zone_watermarks(fields, &node->watermarks);
+    }
+}
+
+/*
+ * Sums up zone watermarks from /proc/zoneinfo without parsing the rest of the file.
+ * Per-node stats lines are skipped by name lookup and pagesets blocks, which make up most of the
+ * file, are skipped entirely by jumping to the next "Node" line.
+ * When per-node tracking is enabled watermarks of each node are updated as well.
+ */
+static int zoneinfo_parse_watermarks(struct zone_watermarks *watermarks) {
+    /* zone fields indexed by enum zoneinfo_wmark_field, protection holds the max protection */
+    int64_t fields[ZI_WMARK_FIELD_COUNT];
+    const char *line;
+    const char *next_line;
+    struct node_info *node = NULL;
+    bool in_zone = false;
+    bool zone_found = false;
+
     memset(watermarks, 0, sizeof(struct zone_watermarks));
+    for (auto& n : nodes) {
+        memset(&n.watermarks, 0, sizeof(struct zone_watermarks));
+    }
+
+    if ((line = reread_file(&zoneinfo_file_data)) == NULL) {
+        return -1;
+    }
+
+    for (; *line; line = next_line) {
+        const char *line_end = scan_line_end(line);
+        const char *name;
+        const char *name_end;
+        int field_idx;
 
-    for (int node_idx = 0; node_idx < zi->node_count; node_idx++) {
-        struct zoneinfo_node *node = &zi->nodes[node_idx];
-        for (int zone_idx = 0; zone_idx < node->zone_count; zone_idx++) {
-            struct zoneinfo_zone *zone = &node->zones[zone_idx];
+        next_line = *line_end ? line_end + 1 : line_end;
 
-            if (!zone->fields.field.present) {
-                continue;
+        if (!strncmp(line, "Node ", 5)) {
+            /* zone header line, "Node <node_id>, zone <zone_name>" */
+            int64_t node_id;
+
+            if (in_zone) {
+                zoneinfo_add_zone_watermarks(fields, watermarks, node);
             }
+            node = (per_node_tracking() && scan_int64(line + 5, &node_id)) ?
+                    node_info_find((int)node_id) : NULL;
+            memset(fields, 0, sizeof(fields));
+            in_zone = true;
+            zone_found = true;
+            continue;
+        }
+        if (!in_zone) {
+            continue;
+        }
 
-            watermarks->high_wmark += zone->max_protection + zone->fields.field.high;
-            watermarks->low_wmark += zone->max_protection + zone->fields.field.low;
-            watermarks->min_wmark += zone->max_protection + zone->fields.field.min;
+        for (name = line; *name == ' '; name++);
+        name_end = (const char *)memchr(name, ' ', line_end - name);
+        field_idx = zoneinfo_wmark_field_index.find(name, (name_end ? name_end : line_end) - name);
+        switch (field_idx) {
+        case ZI_WMARK_PAGESETS:
+            /* no more fields we are interested in, skip to the next zone */
+            zoneinfo_add_zone_watermarks(fields, watermarks, node);
+            in_zone = false;
+            if ((next_line = strstr(line_end, "\nNode ")) == NULL) {
+                return 0;
+            }
+            next_line++;
+            break;
+        case ZI_WMARK_PROTECTION:
+            /* a bare "protection" line carries no values */
+            fields[ZI_WMARK_PROTECTION] =
+                    name_end ? zoneinfo_max_protection(name_end, line_end) : 0;
+            break;
+        case -1:
+            break;
+        default:
+            if (!name_end || !scan_int64(name_end, &fields[field_idx])) {
+                ALOGE("%s parse error", zoneinfo_file_data.filename);
+                return -1;
+            }
+            break;
         }
     }
+
+    if (!zone_found) {
+        ALOGE("%s parse error", zoneinfo_file_data.filename);
+        return -1;
+    }
+    if (in_zone) {
+        zoneinfo_add_zone_watermarks(fields, watermarks, node);
+    }
+    return 0;
 }
 
-static int update_zoneinfo_watermarks(struct zoneinfo *zi) {
-    if (zoneinfo_parse(zi) < 0) {
+static int update_zoneinfo_watermarks() {
+    if (zoneinfo_parse_watermarks(&watermarks) < 0) {
         ALOGE("Failed to parse zoneinfo!");
         return -1;
     }
-    calc_zone_watermarks(zi, &watermarks);
     return 0;
 }
 
@@ -2743,7 +4104,8 @@ static void __mp_event_psi(enum event_source source, union psi_event_data data,
     bool cycle_after_kill = false;
     enum reclaim_state reclaim = NO_RECLAIM;
     enum zone_watermark wmark = WMARK_NONE;
-    char kill_desc[LINE_MAX];
+    int starved_node = -1;
+    char kill_desc[KILL_DESC_LEN];
     bool cut_thrashing_limit = false;
     int min_score_adj = 0;
     int swap_util = 0;
@@ -2914,9 +4276,7 @@ update_watermarks:
      */
     if (watermarks.high_wmark == 0 || (!mem_event_update_zoneinfo_supported &&
         get_time_diff_ms(&wmark_update_tm, &curr_tm) > 60000)) {
-        struct zoneinfo zi;
-
-        if (update_zoneinfo_watermarks(&zi) < 0) {
+        if (update_zoneinfo_watermarks() < 0) {
             return;
         }
         wmark_update_tm = curr_tm;
@@ -2924,9 +4284,27 @@ update_watermarks:
 
     /* Find out which watermark is breached if any */
     wmark = get_lowest_watermark(&mi, &watermarks);
+    if (per_node_tracking()) {
+        /* A single exhausted node might be hidden by the system-wide totals */
+        int node_id;
+        enum zone_watermark node_wmark = get_lowest_node_watermark(&node_id);
+
+        if (node_wmark < wmark) {
+            wmark = node_wmark;
+            starved_node = node_id;
+        }
+    }
 
     if (!psi_parse_mem(&psi_data)) {
-        critical_stall = psi_data.mem_stats[PSI_FULL].avg10 > (float)stall_limit_critical;
+        /* Fall back to the 10s average until a stall rate window is complete */
+        float stall_pct = stall_window_ms > 0 ?
+                psi_stall_rate_update(&mem_full_stall_rate, psi_data.mem_stats[PSI_FULL].total,
+                                      &curr_tm) : -1;
+
+        if (stall_pct < 0) {
+            stall_pct = psi_data.mem_stats[PSI_FULL].avg10;
+        }
+        critical_stall = stall_pct > (float)stall_limit_critical;
     }
     /*
      * TODO: move this logic into a separate function
@@ -3056,7 +4434,13 @@ update_watermarks:
             .kill_desc = kill_desc,
             .thrashing = (int)thrashing,
             .max_thrashing = max_thrashing,
+            .starved_node = starved_node,
         };
+
+        if (starved_node >= 0) {
+            size_t len = strlen(kill_desc);
+            snprintf(kill_desc + len, sizeof(kill_desc) - len, " on node %d", starved_node);
+        }
         static bool first_kill = true;
 
         /* Make sure watermarks are correct before the first kill */
@@ -3072,7 +4456,18 @@ update_watermarks:
         }
         psi_parse_io(&psi_data);
         psi_parse_cpu(&psi_data);
-        int pages_freed = find_and_kill_process(min_score_adj, &ki, &mi, &wi, &curr_tm, &psi_data);
+        int pages_freed = 0;
+
+        /* Cover the whole deficit at once, the target of a starved node is not estimated */
+        if (kill_plan_max_victims > 1 && starved_node < 0) {
+            pages_freed = kill_planned_processes(min_score_adj,
+                                                 get_reclaim_target(&mi, swap_low_threshold),
+                                                 &ki, &mi, &wi, &curr_tm, &psi_data);
+        }
+        if (pages_freed <= 0) {
+            pages_freed = find_and_kill_process(min_score_adj, &ki, &mi, &wi, &curr_tm,
+                                                &psi_data);
+        }
         if (pages_freed > 0) {
             killing = true;
             max_thrashing = 0;
@@ -3134,7 +4529,8 @@ static void mp_event_common(int data, uint32_t events, struct polling_params *po
     int64_t mem_usage, memsw_usage;
     int64_t mem_pressure;
     union meminfo mi;
-    struct zoneinfo zi;
+    /* static to reuse the node storage */
+    static struct zoneinfo zi;
     struct timespec curr_tm;
     static unsigned long kill_skip_count = 0;
     enum vmpressure_level level = (enum vmpressure_level)data;
@@ -3221,7 +4617,7 @@ static void mp_event_common(int data, uint32_t events, struct polling_params *po
         kill_skip_count = 0;
     }
 
-    if (meminfo_parse(&mi) < 0 || zoneinfo_parse(&zi) < 0) {
+    if (meminfo_parse(&mi) < 0) {
         ALOGE("Failed to get free memory!");
         return;
     }
@@ -3229,6 +4625,12 @@ static void mp_event_common(int data, uint32_t events, struct polling_params *po
     if (use_minfree_levels) {
         int i;
 
+        /* only the minfree levels path needs totalreserve_pages from the full zoneinfo */
+        if (zoneinfo_parse(&zi) < 0) {
+            ALOGE("Failed to get free memory!");
+            return;
+        }
+
         other_free = mi.field.nr_free_pages - zi.totalreserve_pages;
         if (mi.field.nr_file_pages > (mi.field.shmem + mi.field.unevictable + mi.field.swap_cached)) {
             other_file = (mi.field.nr_file_pages - mi.field.shmem -
@@ -3485,11 +4887,9 @@ static void memevent_listener_notification(int data __unused, uint32_t events __
                  __mp_event_psi(VENDOR, event_data, 0, poll_params);
                 break;
             }
-            case MEM_EVENT_UPDATE_ZONEINFO: {
-                struct zoneinfo zi;
-                update_zoneinfo_watermarks(&zi);
+            case MEM_EVENT_UPDATE_ZONEINFO:
+                update_zoneinfo_watermarks();
                 break;
-            }
         }
     }
 }
@@ -3727,6 +5127,114 @@ static void destroy_monitors() {
     }
 }
 
+/* Runs on the sampler thread */
+static void sampler_collect_targets(std::vector<struct ProcSampler::target>& targets) {
+    struct proc_snapshot *snapshot = proc_snapshot_acquire();
+
+    for (const struct proc_candidate& candidate : snapshot->procs) {
+        targets.push_back({ candidate.pid, candidate.gen });
+    }
+    proc_snapshot_release(snapshot);
+}
+
+/* Runs on the sampler thread */
+static bool sampler_sample_proc(int pid, struct ProcSampler::sample& sample) {
+    char buf[pagesize];
+    int64_t rss_kb;
+    int64_t swap_kb;
+
+    /* Zombie processes will not have RSS / Swap fields */
+    if (!read_proc_status(pid, buf, sizeof(buf)) ||
+        !parse_status_tag(buf, PROC_STATUS_RSS_FIELD, &rss_kb) ||
+        !parse_status_tag(buf, PROC_STATUS_SWAP_FIELD, &swap_kb)) {
+        return false;
+    }
+    sample.pid = pid;
+    sample.rss_pages = rss_kb / page_k;
+    sample.swap_pages = swap_kb / page_k;
+    return true;
+}
+
+static ProcSampler proc_sampler(sampler_collect_targets, sampler_sample_proc);
+
+static void proc_sample_handler(int data __unused, uint32_t events __unused,
+                                struct polling_params *poll_params __unused) {
+    struct ProcSampler::sample samples[64];
+    struct timespec curr_tm;
+    ssize_t size;
+    int handled = 0;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &curr_tm);
+    /*
+     * Drain the pipe, a round over many processes takes several batches. The bound keeps a sampler
+     * which outpaces the main thread from starving other events, the pipe stays readable then.
+     */
+    while (handled < PROC_SAMPLE_MAX_PER_WAKEUP) {
+        size = TEMP_FAILURE_RETRY(read(sampler_comm_fd[0], samples, sizeof(samples)));
+        if (size <= 0) {
+            if (size < 0 && errno != EAGAIN) {
+                ALOGE("sampler communication read failed: %s", strerror(errno));
+            }
+            return;
+        }
+        handled += size / sizeof(samples[0]);
+        /* writes of whole samples up to PIPE_BUF are atomic, so are the reads */
+        for (size_t i = 0; i < size / sizeof(samples[0]); i++) {
+            struct proc *procp;
+            int old_rss_pages;
+
+            if (samples[i].pid == 0) {
+                last_sample_round_tm = curr_tm;
+                continue;
+            }
+            /* the pid might have been registered again since it was sampled */
+            if ((procp = pid_lookup(samples[i].pid)) == NULL || procp->gen != samples[i].gen) {
+                continue;
+            }
+            old_rss_pages = procp->rss_pages;
+            procp->rss_pages = samples[i].rss_pages;
+            procp->swap_pages = samples[i].swap_pages;
+            procp->sample_tm = curr_tm;
+            proc_heap_update(procp, old_rss_pages);
+        }
+    }
+}
+
+static bool init_proc_sampler() {
+    static struct event_handler_info sample_hinfo = { 0, proc_sample_handler };
+    struct epoll_event epev;
+
+    if (pipe2(sampler_comm_fd, O_CLOEXEC)) {
+        ALOGE("pipe failed: %s", strerror(errno));
+        return false;
+    }
+    // Ensure main thread never blocks on read
+    if (fcntl(sampler_comm_fd[0], F_SETFL, fcntl(sampler_comm_fd[0], F_GETFL) | O_NONBLOCK)) {
+        ALOGE("fcntl failed: %s", strerror(errno));
+        goto err;
+    }
+
+    epev.events = EPOLLIN;
+    epev.data.ptr = (void *)&sample_hinfo;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, sampler_comm_fd[0], &epev)) {
+        ALOGE("epoll_ctl failed: %s", strerror(errno));
+        goto err;
+    }
+    if (!proc_sampler.init(sampler_comm_fd[1], proc_sample_interval_ms)) {
+        if (epoll_ctl(epollfd, EPOLL_CTL_DEL, sampler_comm_fd[0], &epev)) {
+            ALOGE("epoll_ctl failed: %s", strerror(errno));
+        }
+        goto err;
+    }
+    maxevents++;
+    return true;
+
+err:
+    close(sampler_comm_fd[0]);
+    close(sampler_comm_fd[1]);
+    return false;
+}
+
 static void drop_reaper_comm() {
     close(reaper_comm_fd[0]);
     close(reaper_comm_fd[1]);
@@ -3786,10 +5294,6 @@ static bool init_reaper() {
 
 static int init(void) {
     static struct event_handler_info kernel_poll_hinfo = { 0, kernel_event_handler };
-    struct reread_data file_data = {
-        .filename = ZONEINFO_PATH,
-        .fd = -1,
-    };
     struct epoll_event epev;
     int pidfd;
     int i;
@@ -3866,16 +5370,33 @@ static int init(void) {
         procadjslot_list[i].next = &procadjslot_list[i];
         procadjslot_list[i].prev = &procadjslot_list[i];
     }
+    for (i = 0; i < UIDHASH_SIZE; i++) {
+        uidhash[i].next = &uidhash[i];
+        uidhash[i].prev = &uidhash[i];
+    }
 
-    memset(killcnt_idx, KILLCNT_INVALID_IDX, sizeof(killcnt_idx));
+    /* Preallocate process records to avoid allocations when processes get registered */
+    if (!use_inkernel_interface) {
+        proc_pool_grow();
+    }
+    if (!proc_names.reserve(proc_pool_chunk_size * PROC_NAME_AVG_LEN)) {
+        ALOGW("Failed to preallocate process names");
+    }
 
-    /*
-     * Read zoneinfo as the biggest file we read to create and size the initial
-     * read buffer and avoid memory re-allocations during memory pressure
-     */
-    if (reread_file(&file_data) == NULL) {
-        ALOGE("Failed to read %s: %s", file_data.filename, strerror(errno));
+    /* Discover memory nodes first, their meminfo files get read buffers too */
+    init_node_info();
+
+    /* Preallocate read buffers to avoid allocations under memory pressure */
+    reread_data_prime(&zoneinfo_file_data);
+    reread_data_prime(&meminfo_file_data);
+    reread_data_prime(&vmstat_file_data);
+    for (i = 0; i < PSI_RESOURCE_COUNT; i++) {
+        reread_data_prime(&psi_file_data[i]);
     }
+    for (auto& node : nodes) {
+        reread_data_prime(&node.meminfo_data);
+    }
+    reread_bufs_primed = true;
 
     /* check if kernel supports pidfd_open syscall */
     pidfd = TEMP_FAILURE_RETRY(pidfd_open(getpid(), 0));
@@ -3910,6 +5431,9 @@ static void call_handler(struct event_handler_info* handler_info,
                          struct polling_params *poll_params, uint32_t events) {
     struct timespec curr_tm;
 
+    if (debug_process_killing) {
+        clock_gettime(CLOCK_MONOTONIC, &handler_start_tm);
+    }
     watchdog.start();
     poll_params->update = POLLING_DO_NOT_CHANGE;
     handler_info->handler(handler_info->data, events, poll_params);
@@ -3953,6 +5477,7 @@ static void mainloop(void) {
     struct timespec curr_tm;
     struct epoll_event *evt;
     long delay = -1;
+    long publish_delay;
 
     poll_params.poll_handler = NULL;
     poll_params.paused_handler = NULL;
@@ -3962,6 +5487,10 @@ static void mainloop(void) {
         int nevents;
         int i;
 
+        /* Let other threads see process changes made while handling the previous events */
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &curr_tm);
+        publish_delay = proc_snapshot_publish(&curr_tm);
+
         if (poll_params.poll_handler) {
             bool poll_now;
 
@@ -3990,21 +5519,30 @@ static void mainloop(void) {
         } else {
             if (kill_timeout_ms && is_waiting_for_kill()) {
                 clock_gettime(CLOCK_MONOTONIC_COARSE, &curr_tm);
-                delay = kill_timeout_ms - get_time_diff_ms(&last_kill_tm, &curr_tm);
-                /* Wait for pidfds notification or kill timeout to expire */
+                delay = kill_wait_timeout_ms(&curr_tm);
+                /* Wait for pidfds notification or the oldest kill timeout to expire */
                 nevents = (delay > 0) ? epoll_wait(epollfd, events, maxevents, delay) : 0;
                 if (nevents == 0) {
                     /* Kill notification timed out */
-                    stop_wait_for_proc_kill(false);
-                    if (polling_paused(&poll_params)) {
-                        clock_gettime(CLOCK_MONOTONIC_COARSE, &curr_tm);
+                    clock_gettime(CLOCK_MONOTONIC_COARSE, &curr_tm);
+                    stop_wait_for_expired_kills(&curr_tm);
+                    /* Resume polling once no kill is in flight */
+                    if (!is_waiting_for_kill() && polling_paused(&poll_params)) {
                         poll_params.update = POLLING_RESUME;
                         resume_polling(&poll_params, curr_tm);
                     }
                 }
             } else {
-                /* Wait for events with no timeout */
-                nevents = epoll_wait(epollfd, events, maxevents, -1);
+                /* No memory pressure, grow the process record pool if it runs low */
+                if (!use_inkernel_interface) {
+                    proc_pool_refill();
+                    proc_snapshot_reserve();
+                }
+                /*
+                 * Wait for events with no timeout unless process changes are not published or
+                 * pidfds of removed processes are not closed yet
+                 */
+                nevents = epoll_wait(epollfd, events, maxevents, publish_delay);
             }
         }
 
@@ -4139,6 +5677,10 @@ static bool update_props() {
         (int64_t)GET_LMK_PROPERTY(int32, "downgrade_pressure", 100);
     kill_heaviest_task =
         GET_LMK_PROPERTY(bool, "kill_heaviest_task", false);
+    kill_uid_group = GET_LMK_PROPERTY(bool, "kill_uid_group", false);
+    kill_signal_first = GET_LMK_PROPERTY(bool, "kill_signal_first", false);
+    kill_plan_max_victims = std::clamp(GET_LMK_PROPERTY(int32, "kill_plan_max_victims", 1), 1,
+                                       MAX_KILL_WAIT);
     low_ram_device = property_get_bool("ro.config.low_ram", false);
     kill_timeout_ms =
         (unsigned long)GET_LMK_PROPERTY(int32, "kill_timeout_ms", 100);
@@ -4164,6 +5706,8 @@ static bool update_props() {
     swap_util_max = clamp(0, 100, GET_LMK_PROPERTY(int32, "swap_util_max", 100));
     filecache_min_kb = GET_LMK_PROPERTY(int64, "filecache_min_kb", 0);
     stall_limit_critical = GET_LMK_PROPERTY(int64, "stall_limit_critical", 100);
+    stall_window_ms = std::max(0, GET_LMK_PROPERTY(int32, "stall_window_ms", DEF_STALL_WINDOW_MS));
+    psi_stall_rate_init(&mem_full_stall_rate, stall_window_ms);
     delay_monitors_until_boot = GET_LMK_PROPERTY(bool, "delay_monitors_until_boot", false);
     direct_reclaim_threshold_ms =
             GET_LMK_PROPERTY(int64, "direct_reclaim_threshold_ms", DEF_DIRECT_RECL_THRESH_MS);
@@ -4172,6 +5716,24 @@ static bool update_props() {
     lowmem_min_oom_score =
             std::max(PERCEPTIBLE_APP_ADJ + 1,
                      GET_LMK_PROPERTY(int32, "lowmem_min_oom_score", DEF_LOWMEM_MIN_SCORE));
+    /* nodes are discovered at init only, a later change has no effect */
+    per_node_watermarks = GET_LMK_PROPERTY(bool, "per_node_watermarks", false);
+    /* a new size applies to chunks allocated afterwards */
+    proc_pool_chunk_size = std::max(PROC_POOL_MIN_SIZE,
+                                    GET_LMK_PROPERTY(int32, "proc_pool_size", DEF_PROC_POOL_SIZE));
+    proc_sample_interval_ms = std::max(0, GET_LMK_PROPERTY(int32, "proc_sample_interval_ms",
+                                                           DEF_PROC_SAMPLE_INTERVAL_MS));
+    if (kill_signal_first && proc_sample_interval_ms == 0) {
+        /* signal-first kills rely on sampled sizes */
+        proc_sample_interval_ms = SIGNAL_FIRST_SAMPLE_INTERVAL_MS;
+        ALOGI("ro.lmk.kill_signal_first enables process sampling every %dms",
+              proc_sample_interval_ms);
+    }
+    proc_sampler.set_interval(proc_sample_interval_ms);
+    if (kill_plan_max_victims > 1 && proc_sample_interval_ms == 0) {
+        ALOGW("ro.lmk.kill_plan_max_victims needs ro.lmk.proc_sample_interval_ms, "
+              "killing one process at a time");
+    }
 
     reaper.enable_debug(debug_process_killing);
 
@@ -4196,12 +5758,27 @@ int main(int argc, char **argv) {
         }
     }
 
+    /* Reading system files from elsewhere is for testing, never honor it on user builds */
+    if (property_get_bool("ro.debuggable", false)) {
+        char fs_root[PROPERTY_VALUE_MAX];
+
+        property_get(LMKD_FS_ROOT_PROP, fs_root, "");
+        if (!procfs_set_root(fs_root)) {
+            ALOGE(LMKD_FS_ROOT_PROP " is too long");
+            return -1;
+        }
+        if (procfs_root()[0]) {
+            ALOGI("Reading system files under %s", procfs_root());
+        }
+    }
+
     if (!update_props()) {
         ALOGE("Failed to initialize props, exiting.");
         return -1;
     }
 
     ctx = create_android_logger(KILLINFO_LOG_TAG);
+    watchdog_ctx = create_android_logger(KILLINFO_LOG_TAG);
 
     if (!init()) {
         if (!use_inkernel_interface) {
@@ -4235,13 +5812,22 @@ int main(int argc, char **argv) {
                 reaper.thread_cnt());
         }
 
-        if (!watchdog.init()) {
+        if (!init_watchdog_comm() || !watchdog.init()) {
             ALOGE("Failed to initialize the watchdog");
         }
 
+        if (!use_inkernel_interface && !init_proc_sampler()) {
+            ALOGE("Failed to initialize the process sampler");
+        }
+
+        if (!telemetry.init(TELEMETRY_RING_SIZE)) {
+            ALOGE("Failed to initialize telemetry, kills are reported synchronously");
+        }
+
         mainloop();
     }
 
+    android_log_destroy(&watchdog_ctx);
     android_log_destroy(&ctx);
 
     ALOGI("exiting");
@@ -0,0 +1,98 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#define LOG_TAG "lowmemorykiller"
+
+#include <log/log.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "name_arena.h"
+
+NameArena::~NameArena() {
+    free(buf_);
+}
+
+bool NameArena::rebuild(size_t new_size) {
+    char *new_buf = static_cast<char*>(malloc(new_size));
+    size_t offset = 0;
+
+    if (!new_buf) {
+        ALOGE("Failed to allocate %zu bytes for process names", new_size);
+        return false;
+    }
+    for (struct slot& slot : slots_) {
+        if (!slot.used) {
+            continue;
+        }
+        memcpy(new_buf + offset, buf_ + slot.offset, slot.len + 1);
+        slot.offset = offset;
+        offset += slot.len + 1;
+    }
+    free(buf_);
+    buf_ = new_buf;
+    size_ = new_size;
+    used_ = offset;
+    garbage_ = 0;
+    return true;
+}
+
+bool NameArena::reserve(size_t size) {
+    return size <= size_ || rebuild(size);
+}
+
+int NameArena::store(const char *name) {
+    size_t len = strnlen(name, max_len_);
+    int handle;
+
+    if (used_ + len + 1 > size_) {
+        size_t live = used_ - garbage_;
+        size_t new_size = size_;
+
+        // compact in place of growing while at least half of the buffer is garbage
+        if (live + len + 1 > size_ / 2) {
+            new_size = std::max(size_ * 2, live + len + 1);
+        }
+        if (!rebuild(new_size)) {
+            return INVALID_HANDLE;
+        }
+    }
+
+    if (free_slot_ != INVALID_HANDLE) {
+        handle = free_slot_;
+        free_slot_ = static_cast<int>(slots_[handle].offset);
+    } else {
+        handle = slots_.size();
+        slots_.push_back({});
+    }
+    slots_[handle] = { static_cast<uint32_t>(used_), static_cast<uint32_t>(len), true };
+    memcpy(buf_ + used_, name, len);
+    buf_[used_ + len] = '\0';
+    used_ += len + 1;
+    return handle;
+}
+
+void NameArena::release(int handle) {
+    if (handle == INVALID_HANDLE || !slots_[handle].used) {
+        return;
+    }
+    garbage_ += slots_[handle].len + 1;
+    slots_[handle].used = false;
+    slots_[handle].offset = static_cast<uint32_t>(free_slot_);
+    free_slot_ = handle;
+}
@@ -0,0 +1,67 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/*
+ * Compact storage for process names. Names are stored back to back in a single buffer and are
+ * referenced by handles, so that the buffer can be compacted once released names waste too much
+ * of it without updating the owners of the names. Not thread safe.
+ */
+class NameArena {
+public:
+    static constexpr int INVALID_HANDLE = -1;
+private:
+    struct slot {
+        // offset of the name in buf_, index of the next free slot if the slot is unused
+        uint32_t offset;
+        // length of the name without the terminating NUL
+        uint32_t len;
+        bool used;
+    };
+    char *buf_;
+    size_t size_;
+    // bytes used at the beginning of buf_, including released names
+    size_t used_;
+    // bytes of released names
+    size_t garbage_;
+    size_t max_len_;
+    std::vector<struct slot> slots_;
+    // head of the free slot list, INVALID_HANDLE if empty
+    int free_slot_;
+
+    // moves live names into a new buffer of new_size bytes
+    bool rebuild(size_t new_size);
+public:
+    explicit NameArena(size_t max_len) : buf_(nullptr), size_(0), used_(0), garbage_(0),
+                                         max_len_(max_len), free_slot_(INVALID_HANDLE) {}
+    ~NameArena();
+
+    // Preallocates room for names of the given total size
+    bool reserve(size_t size);
+    // Copies the name truncated to max_len bytes, returns INVALID_HANDLE if out of memory
+    int store(const char *name);
+    void release(int handle);
+    // Returns the name, valid until the next store()
+    const char *get(int handle) const {
+        return handle == INVALID_HANDLE ? nullptr : buf_ + slots_[handle].offset;
+    }
+};
@@ -0,0 +1,147 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <log/log.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Records indexed by pid in an open-addressing table with linear probing. The pid is stored next
+ * to the record pointer so that probing does not dereference records. Empty entries have pid 0.
+ * The table doubles when it gets half full and never shrinks. Not thread safe.
+ */
+template <typename T>
+class PidTable {
+    struct entry {
+        int pid;
+        T *record;
+    };
+    static constexpr uint32_t kMinSize = 1024;
+
+    entry *entries_ = nullptr;
+    /* always a power of 2 */
+    uint32_t size_ = 0;
+    uint32_t count_ = 0;
+
+    /* Fibonacci hashing spreads sequential pids over the whole table */
+    static uint32_t index(int pid, uint32_t size) {
+        return ((uint32_t)pid * 2654435769u) >> (32 - __builtin_ctz(size));
+    }
+
+    /* Returns the entry holding pid or the empty entry terminating its probe sequence */
+    static entry *probe(entry *table, uint32_t size, int pid) {
+        uint32_t mask = size - 1;
+        uint32_t idx = index(pid, size);
+
+        while (table[idx].pid != pid && table[idx].pid != 0) {
+            idx = (idx + 1) & mask;
+        }
+        return &table[idx];
+    }
+
+    /* Rehashes all records into a table of new_size entries */
+    bool resize(uint32_t new_size) {
+        entry *new_entries = static_cast<entry*>(calloc(new_size, sizeof(*new_entries)));
+
+        if (!new_entries) {
+            ALOGE("Failed to allocate process table of %u entries", new_size);
+            return false;
+        }
+        for (uint32_t i = 0; i < size_; i++) {
+            if (entries_[i].pid != 0) {
+                *probe(new_entries, new_size, entries_[i].pid) = entries_[i];
+            }
+        }
+        free(entries_);
+        entries_ = new_entries;
+        size_ = new_size;
+        return true;
+    }
+
+public:
+    PidTable() = default;
+    PidTable(const PidTable&) = delete;
+    PidTable& operator=(const PidTable&) = delete;
+    ~PidTable() { free(entries_); }
+
+    uint32_t count() const { return count_; }
+
+    /* Returns the record of pid, nullptr if there is none */
+    T *find(int pid) const {
+        if (pid <= 0 || !entries_) {
+            return nullptr;
+        }
+        return probe(entries_, size_, pid)->record;
+    }
+
+    /* Adds or replaces the record of pid. Returns false if the table is full. */
+    bool insert(int pid, T *record) {
+        entry *e;
+
+        if (count_ + 1 > size_ / 2 && !resize(size_ ? size_ * 2 : kMinSize)) {
+            /* keep filling the current table while it still has an empty entry to end probing */
+            if (count_ + 1 >= size_) {
+                return false;
+            }
+        }
+        e = probe(entries_, size_, pid);
+        if (e->pid == 0) {
+            count_++;
+        }
+        e->pid = pid;
+        e->record = record;
+        return true;
+    }
+
+    /*
+     * Removes the record of pid and returns it, nullptr if there is none. The following entries
+     * of the probe sequence are shifted back, so that no tombstones are needed.
+     */
+    T *erase(int pid) {
+        uint32_t mask = size_ - 1;
+        uint32_t hole;
+        uint32_t idx;
+        T *record;
+
+        if (pid <= 0 || !entries_) {
+            return nullptr;
+        }
+        hole = probe(entries_, size_, pid) - entries_;
+        if (!(record = entries_[hole].record)) {
+            return nullptr;
+        }
+        for (idx = hole;;) {
+            uint32_t home;
+
+            idx = (idx + 1) & mask;
+            if (entries_[idx].pid == 0) {
+                break;
+            }
+            home = index(entries_[idx].pid, size_);
+            /* move the entry unless its home lies cyclically within (hole, idx] */
+            if (((idx - home) & mask) >= ((idx - hole) & mask)) {
+                entries_[hole] = entries_[idx];
+                hole = idx;
+            }
+        }
+        entries_[hole].pid = 0;
+        entries_[hole].record = nullptr;
+        count_--;
+        return record;
+    }
+};
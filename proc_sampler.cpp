@@ -0,0 +1,143 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#define LOG_TAG "lowmemorykiller"
+
+#include <errno.h>
+#include <limits.h>
+#include <log/log.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include <processgroup/processgroup.h>
+#include <system/thread_defs.h>
+
+#include "proc_sampler.h"
+
+// Samples sent with a single write, small enough for the write to be atomic
+#define SAMPLE_BATCH_SIZE (PIPE_BUF / sizeof(struct ProcSampler::sample))
+
+static void* sampler_main(void* param) {
+    ProcSampler *sampler = static_cast<ProcSampler*>(param);
+    pid_t tid = gettid();
+    struct sched_param sampler_param = { .sched_priority = 0 };
+
+    // Threads inherit the real-time policy of the main thread, sampling should never compete
+    // with it or with the apps
+    if (sched_setscheduler(tid, SCHED_OTHER, &sampler_param)) {
+        ALOGW("Failed to reset the sampler thread scheduling policy: %s", strerror(errno));
+    }
+    if (setpriority(PRIO_PROCESS, tid, ANDROID_PRIORITY_BACKGROUND)) {
+        ALOGW("Failed to lower the sampler thread priority: %s", strerror(errno));
+    }
+    if (!SetTaskProfiles(tid, {"CPUSET_SP_BACKGROUND"}, true)) {
+        ALOGW("Failed to assign cpuset to the sampler thread");
+    }
+
+    sampler->run();
+    return NULL;
+}
+
+bool ProcSampler::init(int comm_fd, int interval_ms) {
+    pthread_t thread;
+
+    if (initialized_) {
+        // init should not be called multiple times
+        return false;
+    }
+
+    comm_fd_ = comm_fd;
+    interval_ms_ = interval_ms;
+    if (pthread_create(&thread, NULL, sampler_main, this)) {
+        ALOGE("pthread_create failed: %s", strerror(errno));
+        return false;
+    }
+    if (pthread_setname_np(thread, "lmkd_sampler")) {
+        ALOGW("pthread_setname_np failed: %s", strerror(errno));
+    }
+    initialized_ = true;
+
+    return true;
+}
+
+void ProcSampler::set_interval(int interval_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    interval_ms_ = interval_ms;
+    cond_.notify_one();
+}
+
+bool ProcSampler::wait_interval() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    int interval_ms = interval_ms_;
+
+    if (interval_ms == 0) {
+        cond_.wait(lock, [this] { return interval_ms_ != 0; });
+        // sample right away after being resumed
+        return true;
+    }
+    // a changed interval takes effect immediately
+    return !cond_.wait_for(lock, std::chrono::milliseconds(interval_ms),
+                           [this, interval_ms] { return interval_ms_ != interval_ms; });
+}
+
+bool ProcSampler::send(const struct sample *samples, size_t count) {
+    ssize_t size = count * sizeof(*samples);
+
+    if (TEMP_FAILURE_RETRY(write(comm_fd_, samples, size)) != size) {
+        ALOGE("sampler communication write failed: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void ProcSampler::run() {
+    std::vector<struct target> targets;
+    struct sample batch[SAMPLE_BATCH_SIZE];
+    size_t batch_cnt;
+
+    for (;;) {
+        if (!wait_interval()) {
+            continue;
+        }
+
+        targets.clear();
+        collect_(targets);
+        batch_cnt = 0;
+        for (const struct target& target : targets) {
+            if (!sample_(target.pid, batch[batch_cnt])) {
+                continue;
+            }
+            batch[batch_cnt].gen = target.gen;
+            if (++batch_cnt == SAMPLE_BATCH_SIZE) {
+                if (!send(batch, batch_cnt)) {
+                    break;
+                }
+                batch_cnt = 0;
+            }
+        }
+        if (batch_cnt == SAMPLE_BATCH_SIZE) {
+            // the round is incomplete, do not mark its end
+            continue;
+        }
+        batch[batch_cnt++] = { .pid = 0, .gen = 0, .rss_pages = 0, .swap_pages = 0 };
+        send(batch, batch_cnt);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+/*
+ * Low priority thread which periodically samples the size of registered processes, so that victim
+ * selection does not have to read procfs for every candidate. Samples are sent to the main thread
+ * over a pipe. A sample with pid 0 marks the end of a round in which all processes were sampled.
+ */
+class ProcSampler {
+public:
+    struct target {
+        int pid;
+        // generation of the process record, returned in its sample
+        uint32_t gen;
+    };
+    struct sample {
+        int pid;
+        // generation of the sampled record, the record of a reused pid has another one
+        uint32_t gen;
+        // resident and swapped out sizes in pages
+        int rss_pages;
+        int swap_pages;
+    };
+    // fills the vector with the processes to sample
+    typedef void (*collect_fn)(std::vector<struct target>& targets);
+    // returns false if the process is gone
+    typedef bool (*sample_fn)(int pid, struct sample& sample);
+private:
+    // mutex_ and cond_ are used to wakeup the sampler thread when the interval changes.
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    // mutex_ protects interval_ms_, 0 pauses sampling
+    int interval_ms_;
+    // write side of the pipe to send samples to the main thread
+    int comm_fd_;
+    bool initialized_;
+    collect_fn collect_;
+    sample_fn sample_;
+
+    // sleeps until the next sampling round, returns false if sampling got paused
+    bool wait_interval();
+    bool send(const struct sample *samples, size_t count);
+public:
+    ProcSampler(collect_fn collect, sample_fn sample) :
+        interval_ms_(0), comm_fd_(-1), initialized_(false), collect_(collect),
+        sample_(sample) {}
+
+    bool init(int comm_fd, int interval_ms);
+    void set_interval(int interval_ms);
+    // used by the sampler_main
+    void run();
+};
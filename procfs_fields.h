@@ -0,0 +1,367 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "procfs_scan.h"
+
+/*
+ * Fields lmkd reads from files consisting of "<field name> <value>" lines, like /proc/meminfo and
+ * /proc/vmstat, and their parser. Kept in a header of their own so that the parser can be checked
+ * against captured files of different kernels.
+ */
+
+/*
+ * Compile-time hash index over a field name table. Resolves a field name with a single hash
+ * computation and usually a single string comparison instead of comparing the name against
+ * every entry of the table. Most of the lines in files like /proc/vmstat do not match any field
+ * we are interested in, and those are rejected by hitting an empty slot.
+ */
+static constexpr uint32_t field_name_hash(const char* name, size_t len) {
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static constexpr size_t field_name_len(const char* name) {
+    size_t len = 0;
+
+    while (name[len]) {
+        len++;
+    }
+    return len;
+}
+
+template <int N>
+struct field_index {
+    /* keep the table at most 1/4 full so that misses terminate on the first probe */
+    static constexpr int kSlots = N <= 4 ? 16 : N <= 8 ? 32 : N <= 16 ? 64 : 128;
+    static_assert(N <= kSlots / 4, "field table is too large for the hash index");
+
+    const char* const* names;
+    uint8_t name_len[N];
+    /* field index + 1 or 0 for an empty slot */
+    uint8_t slot_field[kSlots];
+
+    constexpr field_index(const char* const (&field_names)[N])
+        : names(field_names), name_len(), slot_field() {
+        for (int i = 0; i < N; i++) {
+            size_t len = field_name_len(field_names[i]);
+            uint32_t slot = field_name_hash(field_names[i], len) & (kSlots - 1);
+
+            while (slot_field[slot]) {
+                slot = (slot + 1) & (kSlots - 1);
+            }
+            slot_field[slot] = i + 1;
+            name_len[i] = len;
+        }
+    }
+
+    int find(const char* name, size_t len) const {
+        uint32_t slot = field_name_hash(name, len) & (kSlots - 1);
+
+        while (slot_field[slot]) {
+            int i = slot_field[slot] - 1;
+            if (name_len[i] == len && !memcmp(name, names[i], len)) {
+                return i;
+            }
+            slot = (slot + 1) & (kSlots - 1);
+        }
+        return -1;
+    }
+
+    int find(const char* name) const { return find(name, strlen(name)); }
+};
+
+/* Fields to parse in /proc/meminfo */
+enum meminfo_field {
+    MI_NR_FREE_PAGES = 0,
+    MI_CACHED,
+    MI_SWAP_CACHED,
+    MI_BUFFERS,
+    MI_SHMEM,
+    MI_UNEVICTABLE,
+    MI_TOTAL_SWAP,
+    MI_FREE_SWAP,
+    MI_ACTIVE_ANON,
+    MI_INACTIVE_ANON,
+    MI_ACTIVE_FILE,
+    MI_INACTIVE_FILE,
+    MI_SRECLAIMABLE,
+    MI_SUNRECLAIM,
+    MI_KERNEL_STACK,
+    MI_PAGE_TABLES,
+    MI_ION_HELP,
+    MI_ION_HELP_POOL,
+    MI_CMA_FREE,
+    MI_FIELD_COUNT
+};
+
+static constexpr const char* meminfo_field_names[MI_FIELD_COUNT] = {
+    "MemFree:",
+    "Cached:",
+    "SwapCached:",
+    "Buffers:",
+    "Shmem:",
+    "Unevictable:",
+    "SwapTotal:",
+    "SwapFree:",
+    "Active(anon):",
+    "Inactive(anon):",
+    "Active(file):",
+    "Inactive(file):",
+    "SReclaimable:",
+    "SUnreclaim:",
+    "KernelStack:",
+    "PageTables:",
+    "ION_heap:",
+    "ION_heap_pool:",
+    "CmaFree:",
+};
+
+static constexpr field_index<MI_FIELD_COUNT> meminfo_field_index(meminfo_field_names);
+
+union meminfo {
+    struct {
+        int64_t nr_free_pages;
+        int64_t cached;
+        int64_t swap_cached;
+        int64_t buffers;
+        int64_t shmem;
+        int64_t unevictable;
+        int64_t total_swap;
+        int64_t free_swap;
+        int64_t active_anon;
+        int64_t inactive_anon;
+        int64_t active_file;
+        int64_t inactive_file;
+        int64_t sreclaimable;
+        int64_t sunreclaimable;
+        int64_t kernel_stack;
+        int64_t page_tables;
+        int64_t ion_heap;
+        int64_t ion_heap_pool;
+        int64_t cma_free;
+        /* fields below are calculated rather than read from the file */
+        int64_t nr_file_pages;
+        int64_t total_gpu_kb;
+        int64_t easy_available;
+    } field;
+    int64_t arr[MI_FIELD_COUNT];
+};
+
+/* Fields to parse in /proc/vmstat */
+enum vmstat_field {
+    VS_FREE_PAGES,
+    VS_INACTIVE_FILE,
+    VS_ACTIVE_FILE,
+    VS_WORKINGSET_REFAULT,
+    VS_WORKINGSET_REFAULT_FILE,
+    VS_PGSCAN_KSWAPD,
+    VS_PGSCAN_DIRECT,
+    VS_PGSCAN_DIRECT_THROTTLE,
+    VS_PGREFILL,
+    VS_FIELD_COUNT
+};
+
+static constexpr const char* vmstat_field_names[VS_FIELD_COUNT] = {
+    "nr_free_pages",
+    "nr_inactive_file",
+    "nr_active_file",
+    "workingset_refault",
+    "workingset_refault_file",
+    "pgscan_kswapd",
+    "pgscan_direct",
+    "pgscan_direct_throttle",
+    "pgrefill",
+};
+
+static constexpr field_index<VS_FIELD_COUNT> vmstat_field_index(vmstat_field_names);
+
+/*
+ * Fields which represent the same counter share a group. Starting 5.9 kernel
+ * workingset_refault was renamed workingset_refault_file and only one of them is present.
+ */
+static constexpr int vmstat_field_groups[VS_FIELD_COUNT] = {
+    VS_FREE_PAGES,
+    VS_INACTIVE_FILE,
+    VS_ACTIVE_FILE,
+    VS_WORKINGSET_REFAULT,
+    VS_WORKINGSET_REFAULT,
+    VS_PGSCAN_KSWAPD,
+    VS_PGSCAN_DIRECT,
+    VS_PGSCAN_DIRECT_THROTTLE,
+    VS_PGREFILL,
+};
+
+union vmstat {
+    struct {
+        int64_t nr_free_pages;
+        int64_t nr_inactive_file;
+        int64_t nr_active_file;
+        int64_t workingset_refault;
+        int64_t workingset_refault_file;
+        int64_t pgscan_kswapd;
+        int64_t pgscan_direct;
+        int64_t pgscan_direct_throttle;
+        int64_t pgrefill;
+    } field;
+    int64_t arr[VS_FIELD_COUNT];
+};
+
+/*
+ * Parsing routines for files consisting of "<field name> <value>" lines, like /proc/meminfo and
+ * /proc/vmstat.
+ *
+ * The kernel emits these files with the same line order on every read. After a full parse we
+ * remember which lines hold the fields we are interested in, and on the following reads we only
+ * verify the names of those lines and parse their values, skipping all other lines without
+ * tokenizing them. A mismatch means that the layout has changed (e.g. after a kernel module got
+ * loaded) and we fall back to the full parse, which learns the new layout. The layout is also
+ * relearned periodically to pick up fields which were missing when it was learned.
+ * The full parse stops early once all wanted fields are found.
+ */
+/* limited by the 32-bit mask of matched field groups */
+#define FIELD_LAYOUT_MAX_FIELDS 32
+#define FIELD_LAYOUT_RELEARN_READS 100
+
+struct field_layout_entry {
+    /* number of lines between the previous field and this one */
+    int skip_lines;
+    int field_idx;
+};
+
+struct field_layout {
+    /* number of valid entries, 0 if the layout is unknown */
+    int count;
+    /* number of reads since the layout was learned */
+    int reads;
+    struct field_layout_entry entries[FIELD_LAYOUT_MAX_FIELDS];
+};
+
+template <int N>
+static bool parse_fields_with_layout(const char *buf, const field_index<N>& index,
+                                     const struct field_layout *layout, int64_t *fields) {
+    const char *line = buf;
+
+    for (int i = 0; i < layout->count; i++) {
+        const struct field_layout_entry *entry = &layout->entries[i];
+        size_t len = index.name_len[entry->field_idx];
+
+        for (int skip = entry->skip_lines; skip > 0; skip--) {
+            line = scan_line_end(line);
+            if (*line == '\0') {
+                return false;
+            }
+            line++;
+        }
+        if (strncmp(line, index.names[entry->field_idx], len) || line[len] != ' ') {
+            return false;
+        }
+        if (!(line = scan_int64(line + len, &fields[entry->field_idx]))) {
+            return false;
+        }
+        line = scan_line_end(line);
+        if (*line == '\0') {
+            /* the last line might not be terminated */
+            return i == layout->count - 1;
+        }
+        line++;
+    }
+
+    return true;
+}
+
+/*
+ * Parses fields listed in the index into the fields array, using and maintaining the learned
+ * file layout.
+ * If field_groups is provided, fields of the same group are alternatives (e.g. a counter that was
+ * renamed in newer kernels) and parsing stops as soon as one field of every group is found.
+ * Otherwise parsing stops once all fields are found.
+ */
+template <int N>
+static int parse_fields(const char *buf, const field_index<N>& index, struct field_layout *layout,
+                        int64_t *fields, const int *field_groups = NULL) {
+    static_assert(N <= FIELD_LAYOUT_MAX_FIELDS, "too many fields for the file layout");
+    const char *line;
+    const char *next_line;
+    int line_idx;
+    int prev_field_line = -1;
+    uint32_t groups_to_match = 0;
+    uint32_t groups_matched = 0;
+
+    if (layout->count > 0 && ++layout->reads < FIELD_LAYOUT_RELEARN_READS &&
+        parse_fields_with_layout(buf, index, layout, fields)) {
+        return 0;
+    }
+
+    /* Full parse, learn the file layout while parsing */
+    layout->count = 0;
+    layout->reads = 0;
+    for (int field_idx = 0; field_idx < N; field_idx++) {
+        groups_to_match |= 1u << (field_groups ? field_groups[field_idx] : field_idx);
+    }
+    for (line = buf, line_idx = 0; *line; line = next_line, line_idx++) {
+        const char *line_end = scan_line_end(line);
+        const char *name_end;
+        int field_idx;
+
+        next_line = *line_end ? line_end + 1 : line_end;
+        if (line_end == line) {
+            /* empty line */
+            continue;
+        }
+
+        /* "<field name> <value>" */
+        name_end = (const char *)memchr(line, ' ', line_end - line);
+        if (!name_end) {
+            goto err;
+        }
+
+        field_idx = index.find(line, name_end - line);
+        if (field_idx >= 0) {
+            if (!scan_int64(name_end, &fields[field_idx])) {
+                goto err;
+            }
+            if (layout->count < N) {
+                layout->entries[layout->count].skip_lines = line_idx - prev_field_line - 1;
+                layout->entries[layout->count].field_idx = field_idx;
+                layout->count++;
+            }
+            prev_field_line = line_idx;
+
+            groups_matched |= 1u << (field_groups ? field_groups[field_idx] : field_idx);
+            if (groups_matched == groups_to_match) {
+                /* all fields are found, skip the rest of the file */
+                break;
+            }
+        }
+    }
+
+    return 0;
+err:
+    layout->count = 0;
+    return -1;
+}
@@ -0,0 +1,173 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Scanning helpers for the NUL-terminated text buffers read from procfs. Line ends and digit
+ * runs are located 16 bytes at a time using SSE2 or NEON, selected at build time, with a scalar
+ * fallback for other targets or when PROCFS_SCAN_SCALAR is defined.
+ *
+ * Vector scans use aligned 16-byte loads, which never cross a page boundary, so they can safely
+ * read past the terminating NUL within the last block of the buffer. Sanitizers do not know that,
+ * hence these functions are excluded from instrumentation.
+ */
+#if !defined(PROCFS_SCAN_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#define PROCFS_SCAN_SSE2
+#elif !defined(PROCFS_SCAN_SCALAR) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PROCFS_SCAN_NEON
+#endif
+
+#define PROCFS_SCAN_BLOCK 16
+
+#if defined(__clang__)
+#define PROCFS_SCAN_NO_SANITIZE __attribute__((no_sanitize("address", "hwaddress")))
+#else
+#define PROCFS_SCAN_NO_SANITIZE __attribute__((no_sanitize_address))
+#endif
+
+#if defined(PROCFS_SCAN_SSE2)
+/* Returns the bitmask of '\n' and NUL bytes in the block, one bit per byte */
+static inline uint64_t scan_block_line_end(const char *block) {
+    __m128i v = _mm_load_si128((const __m128i *)block);
+    __m128i eq = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                              _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    return (uint64_t)_mm_movemask_epi8(eq);
+}
+
+/* Returns the bitmask of non-digit bytes in the block, one bit per byte */
+static inline uint64_t scan_block_non_digit(const char *block) {
+    __m128i v = _mm_sub_epi8(_mm_load_si128((const __m128i *)block), _mm_set1_epi8('0'));
+    /* unsigned v <= 9 for digits */
+    __m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(9)), v);
+    return (uint64_t)(~_mm_movemask_epi8(digit) & 0xffff);
+}
+
+#define PROCFS_SCAN_BITS_PER_BYTE 1
+#elif defined(PROCFS_SCAN_NEON)
+/* Narrows a byte mask vector into 4 bits per byte */
+static inline uint64_t scan_neon_mask(uint8x16_t eq) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+}
+
+/* Returns the bitmask of '\n' and NUL bytes in the block, four bits per byte */
+static inline uint64_t scan_block_line_end(const char *block) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)__builtin_assume_aligned(block, PROCFS_SCAN_BLOCK));
+    return scan_neon_mask(vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')), vceqq_u8(v, vdupq_n_u8(0))));
+}
+
+/* Returns the bitmask of non-digit bytes in the block, four bits per byte */
+static inline uint64_t scan_block_non_digit(const char *block) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)__builtin_assume_aligned(block, PROCFS_SCAN_BLOCK));
+    return scan_neon_mask(vcgtq_u8(vsubq_u8(v, vdupq_n_u8('0')), vdupq_n_u8(9)));
+}
+
+#define PROCFS_SCAN_BITS_PER_BYTE 4
+#endif
+
+#if defined(PROCFS_SCAN_SSE2) || defined(PROCFS_SCAN_NEON)
+/*
+ * Returns the first byte starting at str for which the block scanner sets a bit. The block scanner
+ * must set a bit for NUL to guarantee termination.
+ */
+PROCFS_SCAN_NO_SANITIZE
+static inline const char *scan_blocks(const char *str, uint64_t (*scan_block)(const char *)) {
+    uintptr_t offset = (uintptr_t)str & (PROCFS_SCAN_BLOCK - 1);
+    const char *block = str - offset;
+    /* ignore bytes preceding str in the first block */
+    uint64_t mask = scan_block(block) >> (offset * PROCFS_SCAN_BITS_PER_BYTE);
+
+    if (mask) {
+        return str + __builtin_ctzll(mask) / PROCFS_SCAN_BITS_PER_BYTE;
+    }
+    for (;;) {
+        block += PROCFS_SCAN_BLOCK;
+        mask = scan_block(block);
+        if (mask) {
+            return block + __builtin_ctzll(mask) / PROCFS_SCAN_BITS_PER_BYTE;
+        }
+    }
+}
+#endif
+
+/* Returns the position of the first '\n' or the terminating NUL */
+PROCFS_SCAN_NO_SANITIZE
+static inline const char *scan_line_end(const char *str) {
+#if defined(PROCFS_SCAN_SSE2) || defined(PROCFS_SCAN_NEON)
+    return scan_blocks(str, scan_block_line_end);
+#else
+    while (*str != '\n' && *str != '\0') {
+        str++;
+    }
+    return str;
+#endif
+}
+
+static inline char *scan_line_end(char *str) {
+    return (char *)scan_line_end((const char *)str);
+}
+
+/* Returns the position of the first character which is not a decimal digit */
+PROCFS_SCAN_NO_SANITIZE
+static inline const char *scan_digits(const char *str) {
+#if defined(PROCFS_SCAN_SSE2) || defined(PROCFS_SCAN_NEON)
+    return scan_blocks(str, scan_block_non_digit);
+#else
+    while ((unsigned char)(*str - '0') <= 9) {
+        str++;
+    }
+    return str;
+#endif
+}
+
+/*
+ * Parses a decimal integer preceded by optional blanks and sign. Returns the position following
+ * the number or NULL if no number is found or it does not fit into int64_t.
+ */
+static inline const char *scan_int64(const char *str, int64_t *ret) {
+    const char *end;
+    uint64_t val = 0;
+    bool negative;
+
+    while (*str == ' ' || *str == '\t') {
+        str++;
+    }
+    negative = (*str == '-');
+    if (negative || *str == '+') {
+        str++;
+    }
+
+    end = scan_digits(str);
+    /* up to 19 digits cannot overflow uint64_t */
+    if (end == str || end - str > 19) {
+        return NULL;
+    }
+    for (; str < end; str++) {
+        val = val * 10 + (*str - '0');
+    }
+    if (val > (uint64_t)INT64_MAX + negative) {
+        return NULL;
+    }
+
+    *ret = negative ? (int64_t)(0 - val) : (int64_t)val;
+    return end;
+}
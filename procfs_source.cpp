@@ -0,0 +1,113 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#define LOG_TAG "lowmemorykiller"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <log/log.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "procfs_source.h"
+
+static char root_path[PATH_MAX];
+static size_t root_len;
+
+bool procfs_set_root(const char *root) {
+    size_t len;
+
+    if (!root) {
+        root_path[0] = '\0';
+        root_len = 0;
+        return true;
+    }
+
+    len = strlen(root);
+    /* a trailing slash would double the one starting every path */
+    while (len > 0 && root[len - 1] == '/') {
+        len--;
+    }
+    if (len >= sizeof(root_path)) {
+        ALOGE("Filesystem root %s is too long", root);
+        return false;
+    }
+    memcpy(root_path, root, len);
+    root_path[len] = '\0';
+    root_len = len;
+    return true;
+}
+
+const char *procfs_root() {
+    return root_path;
+}
+
+bool procfs_path(char *buf, size_t buf_size, const char *path) {
+    size_t path_len = strlen(path);
+
+    if (root_len + path_len >= buf_size) {
+        return false;
+    }
+    memcpy(buf, root_path, root_len);
+    memcpy(buf + root_len, path, path_len + 1);
+    return true;
+}
+
+/* Returns path itself when no root is set, otherwise the path resolved under the root */
+static const char *resolve(const char *path, char *buf, size_t buf_size) {
+    if (root_len == 0) {
+        return path;
+    }
+    if (!procfs_path(buf, buf_size, path)) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    return buf;
+}
+
+int procfs_open(const char *path, int flags) {
+    char buf[PATH_MAX];
+    const char *resolved;
+
+    if ((flags & O_ACCMODE) != O_RDONLY) {
+        errno = EINVAL;
+        return -1;
+    }
+    resolved = resolve(path, buf, sizeof(buf));
+
+    return resolved ? TEMP_FAILURE_RETRY(open(resolved, flags)) : -1;
+}
+
+int procfs_access(const char *path, int mode) {
+    char buf[PATH_MAX];
+    const char *resolved;
+
+    if (mode & W_OK) {
+        errno = EINVAL;
+        return -1;
+    }
+    resolved = resolve(path, buf, sizeof(buf));
+
+    return resolved ? access(resolved, mode) : -1;
+}
+
+DIR *procfs_opendir(const char *path) {
+    char buf[PATH_MAX];
+    const char *resolved = resolve(path, buf, sizeof(buf));
+
+    return resolved ? opendir(resolved) : NULL;
+}
@@ -0,0 +1,43 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <dirent.h>
+#include <stddef.h>
+
+/*
+ * Source of the procfs, sysfs and cgroup files lmkd reads. By default files are opened at their
+ * real paths. When a root directory is set, every absolute path is resolved under it instead, so
+ * parsers can run against a directory of captured or synthetic snapshots laid out like the real
+ * filesystem, e.g. <root>/proc/meminfo and <root>/proc/<pid>/status. Only reads are redirected,
+ * opening for writing or checking write access fails with EINVAL, files lmkd writes are always
+ * accessed at their real paths. Besides tests, the daemon sets a root only on debuggable builds
+ * from the lmkd.debug.fs_root property.
+ */
+
+/* Sets the root directory, NULL or "" restores the real filesystem. Returns false if too long. */
+bool procfs_set_root(const char *root);
+
+/* Returns the root directory, "" if files are read at their real paths */
+const char *procfs_root();
+
+/* Writes path resolved under the root into buf. Returns false if it does not fit. */
+bool procfs_path(char *buf, size_t buf_size, const char *path);
+
+int procfs_open(const char *path, int flags);
+int procfs_access(const char *path, int mode);
+DIR *procfs_opendir(const char *path);
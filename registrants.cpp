@@ -0,0 +1,129 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "registrants.h"
+
+static inline void list_init(Registrants::node *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static inline bool list_empty(const Registrants::node *head) {
+    return head->next == head;
+}
+
+static inline void list_insert(Registrants::node *head, Registrants::node *n) {
+    n->next = head->next;
+    n->prev = head;
+    head->next->prev = n;
+    head->next = n;
+}
+
+Registrants::Registrants(size_t max_registrants) : registrants_(max_registrants),
+                                                   overflow_cnt_(0) {
+    for (struct registrant& registrant : registrants_) {
+        registrant.pid = 0;
+        list_init(&registrant.procs);
+    }
+    list_init(&unclaimed_);
+}
+
+Registrants::node *Registrants::procs(pid_t pid, bool create) {
+    struct registrant *unused = nullptr;
+
+    if (pid == 0) {
+        return &unclaimed_;
+    }
+    for (struct registrant& registrant : registrants_) {
+        if (registrant.pid == pid) {
+            return &registrant.procs;
+        }
+        if (!unused && list_empty(&registrant.procs)) {
+            unused = &registrant;
+        }
+    }
+    if (!create || !unused) {
+        return nullptr;
+    }
+    unused->pid = pid;
+    return &unused->procs;
+}
+
+void Registrants::insert(node *n) {
+    node *head = procs(n->reg_pid, true);
+
+    n->overflow = head == nullptr;
+    if (n->overflow) {
+        overflow_cnt_++;
+        head = &unclaimed_;
+    }
+    list_insert(head, n);
+}
+
+void Registrants::remove(node *n) {
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    list_init(n);
+    if (n->overflow) {
+        n->overflow = false;
+        overflow_cnt_--;
+    }
+}
+
+bool Registrants::claim(node *n, pid_t pid) {
+    if (n->reg_pid == pid) {
+        /* Record already belongs to the registrant */
+        return true;
+    }
+    if (n->reg_pid != 0) {
+        /* The record is owned by another registrant */
+        return false;
+    }
+    /* Old registrant is gone, claim the record */
+    remove(n);
+    n->reg_pid = pid;
+    insert(n);
+    return true;
+}
+
+void Registrants::release(pid_t pid) {
+    node *head;
+
+    if (pid == 0) {
+        return;
+    }
+    if (overflow_cnt_ > 0) {
+        for (node *curr = unclaimed_.next; curr != &unclaimed_; curr = curr->next) {
+            if (curr->overflow && curr->reg_pid == pid) {
+                curr->reg_pid = 0;
+                curr->overflow = false;
+                overflow_cnt_--;
+            }
+        }
+    }
+    if ((head = procs(pid, false)) == nullptr || list_empty(head)) {
+        return;
+    }
+    for (node *curr = head->next; curr != head; curr = curr->next) {
+        curr->reg_pid = 0;
+    }
+    /* move the whole list to the head of the unclaimed list */
+    head->prev->next = unclaimed_.next;
+    unclaimed_.next->prev = head->prev;
+    unclaimed_.next = head->next;
+    head->next->prev = &unclaimed_;
+    list_init(head);
+}
@@ -0,0 +1,91 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <vector>
+
+/*
+ * Lists of process records per registrant, so that purging the records of a registrant or
+ * releasing them when it disconnects does not visit other records. Records embed a node and are
+ * linked into the list of their registrant, or into the unclaimed list once the registrant is
+ * gone. Registrants are connected clients, so a few entries are enough; records of a registrant
+ * which finds no free entry are kept in the unclaimed list with their owner still set, and are
+ * filtered by owner when that list is walked. Not thread safe.
+ */
+class Registrants {
+public:
+    struct node {
+        node *next;
+        node *prev;
+        // PID of the process that registered the record, 0 if unclaimed
+        pid_t reg_pid;
+        // owned record kept in the unclaimed list because its registrant had no entry
+        bool overflow;
+    };
+private:
+    struct registrant {
+        pid_t pid;
+        // an entry with an empty list is unused
+        node procs;
+    };
+    std::vector<struct registrant> registrants_;
+    node unclaimed_;
+    // number of records with the overflow flag set
+    size_t overflow_cnt_;
+
+    // returns the list of records registered by pid, nullptr if it has none and no entry is free
+    node *procs(pid_t pid, bool create);
+public:
+    explicit Registrants(size_t max_registrants);
+    Registrants(const Registrants&) = delete;
+    Registrants& operator=(const Registrants&) = delete;
+
+    // Links a record registered by n->reg_pid
+    void insert(node *n);
+    // Unlinks a record
+    void remove(node *n);
+    // Moves an unclaimed record to pid. Returns false if the record belongs to another registrant.
+    bool claim(node *n, pid_t pid);
+    // Marks the records of a registrant which went away as unclaimed
+    void release(pid_t pid);
+
+    /*
+     * Calls remove_record for every record pid may purge: its own and the unclaimed ones.
+     * remove_record must unlink the record with remove().
+     */
+    template <typename F>
+    void purge(pid_t pid, F remove_record) {
+        node *lists[] = { pid != 0 ? procs(pid, false) : nullptr, &unclaimed_ };
+
+        for (node *head : lists) {
+            node *next;
+
+            if (!head) {
+                continue;
+            }
+            for (node *curr = head->next; curr != head; curr = next) {
+                next = curr->next;
+                if (curr->reg_pid == pid || curr->reg_pid == 0) {
+                    remove_record(curr);
+                }
+            }
+        }
+    }
+};
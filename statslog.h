@@ -67,6 +67,8 @@ enum kill_reasons {
     LOW_FILECACHE_AFTER_THRASHING,
     LOW_MEM,
     DIRECT_RECL_STUCK,
+    /* number of aosp kill reasons, add new ones above */
+    AOSP_KILL_REASON_COUNT,
     /* reserve aosp kill 0 ~ 999 */
     VENDOR_KILL_REASON_BASE = 1000,
     VENDOR_KILL_REASON_END = VENDOR_KILL_REASON_BASE + NUM_VENDOR_LMK_KILL_REASON - 1,
@@ -110,21 +112,9 @@ struct memory_stat *stats_read_memory_stat(bool per_app_memcg, int pid, uid_t ui
                                            int64_t rss_bytes, int64_t swap_bytes);
 
 /**
- * Registers a process taskname by pid, while it is still alive.
+ * Returns true if kills are reported to statsd (ro.lmk.log_stats).
  */
-void stats_store_taskname(int pid, const char* taskname);
-
-/**
- * Unregister all process tasknames.
- */
-void stats_purge_tasknames();
-
-/**
- * Unregister a process taskname, e.g. after it has been killed.
- */
-void stats_remove_taskname(int pid);
-
-const char* stats_get_task_name(int pid);
+bool stats_log_enabled(void);
 
 #else /* LMKD_LOG_STATS */
 
@@ -141,13 +131,9 @@ static inline struct memory_stat *stats_read_memory_stat(bool per_app_memcg __un
     return NULL;
 }
 
-static inline void stats_store_taskname(int pid __unused, const char* taskname __unused) {}
-
-static inline void stats_purge_tasknames() {}
-
-static inline void stats_remove_taskname(int pid __unused) {}
-
-static inline const char* stats_get_task_name(int pid __unused) { return NULL; }
+static inline bool stats_log_enabled(void) {
+    return false;
+}
 
 #endif /* LMKD_LOG_STATS */
 
@@ -0,0 +1,139 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#define LOG_TAG "lowmemorykiller"
+
+#include <errno.h>
+#include <log/log.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <processgroup/processgroup.h>
+#include <system/thread_defs.h>
+
+#include "telemetry.h"
+
+static void* telemetry_main(void* param) {
+    Telemetry *telemetry = static_cast<Telemetry*>(param);
+    pid_t tid = gettid();
+    struct sched_param telemetry_param = { .sched_priority = 0 };
+
+    // Threads inherit the real-time policy of the main thread, reporting should never compete
+    // with it
+    if (sched_setscheduler(tid, SCHED_OTHER, &telemetry_param)) {
+        ALOGW("Failed to reset the telemetry thread scheduling policy: %s", strerror(errno));
+    }
+    if (setpriority(PRIO_PROCESS, tid, ANDROID_PRIORITY_BACKGROUND)) {
+        ALOGW("Failed to lower the telemetry thread priority: %s", strerror(errno));
+    }
+    if (!SetTaskProfiles(tid, {"CPUSET_SP_BACKGROUND"}, true)) {
+        ALOGW("Failed to assign cpuset to the telemetry thread");
+    }
+
+    telemetry->run();
+    return NULL;
+}
+
+bool Telemetry::init(uint32_t capacity) {
+    pthread_t thread;
+
+    if (event_fd_ >= 0) {
+        // init should not be called multiple times
+        return false;
+    }
+
+    for (capacity_ = 1; capacity_ < capacity; capacity_ <<= 1) {}
+    records_ = static_cast<char*>(calloc(capacity_, record_size_));
+    if (!records_) {
+        ALOGE("Failed to allocate %u telemetry records", capacity_);
+        return false;
+    }
+    event_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (event_fd_ < 0) {
+        ALOGE("eventfd failed: %s", strerror(errno));
+        goto err;
+    }
+    if (pthread_create(&thread, NULL, telemetry_main, this)) {
+        ALOGE("pthread_create failed: %s", strerror(errno));
+        close(event_fd_);
+        event_fd_ = -1;
+        goto err;
+    }
+    if (pthread_setname_np(thread, "lmkd_telemetry")) {
+        ALOGW("pthread_setname_np failed: %s", strerror(errno));
+    }
+
+    return true;
+
+err:
+    free(records_);
+    records_ = nullptr;
+    return false;
+}
+
+void *Telemetry::reserve() {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - head_.load(std::memory_order_acquire) == capacity_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    // the consumer does not touch the slot until commit() publishes it
+    return records_ + (tail & (capacity_ - 1)) * record_size_;
+}
+
+void Telemetry::commit() {
+    uint64_t one = 1;
+
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    if (TEMP_FAILURE_RETRY(write(event_fd_, &one, sizeof(one))) != sizeof(one)) {
+        ALOGE("telemetry wakeup failed: %s", strerror(errno));
+    }
+}
+
+void Telemetry::wait() {
+    uint64_t count;
+
+    // the counter is reset by the read, records pushed after it trigger another wakeup
+    if (TEMP_FAILURE_RETRY(read(event_fd_, &count, sizeof(count))) != sizeof(count)) {
+        ALOGE("telemetry wait failed: %s", strerror(errno));
+    }
+}
+
+void Telemetry::run() {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+
+    for (;;) {
+        if (head == tail_.load(std::memory_order_acquire)) {
+            wait();
+            continue;
+        }
+        report_(records_ + (head & (capacity_ - 1)) * record_size_);
+        head_.store(++head, std::memory_order_release);
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != dropped_reported_) {
+            report_drops_(dropped - dropped_reported_);
+            dropped_reported_ = dropped;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ *  Copyright 2026 Google, Inc
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+/*
+ * Low priority thread which reports kills, so that the main thread does not spend time on logging
+ * before it can react to the next pressure event. Records are passed
+ * through a lock-free single-producer single-consumer ring. When the ring is full new records
+ * are dropped and counted rather than blocking the producer.
+ */
+class Telemetry {
+public:
+    // reports one record, called on the telemetry thread which owns the record until it returns
+    typedef void (*report_fn)(void *record);
+    // called on the telemetry thread when records got dropped since the last call
+    typedef void (*drop_fn)(uint64_t dropped);
+private:
+    size_t record_size_;
+    // number of records, a power of two
+    uint32_t capacity_;
+    char *records_;
+    // only the consumer advances head_ and only the producer advances tail_
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t dropped_reported_;
+    // wakes up the telemetry thread
+    int event_fd_;
+    report_fn report_;
+    drop_fn report_drops_;
+
+    void wait();
+public:
+    Telemetry(size_t record_size, report_fn report, drop_fn report_drops) :
+        record_size_(record_size), capacity_(0), records_(nullptr), head_(0), tail_(0),
+        dropped_(0), dropped_reported_(0), event_fd_(-1), report_(report),
+        report_drops_(report_drops) {}
+
+    // capacity is rounded up to a power of two
+    bool init(uint32_t capacity);
+    bool is_enabled() const { return event_fd_ >= 0; }
+    // Returns the free slot to fill in and queue with commit(), so that records are built in
+    // place. Returns nullptr and counts the record as dropped if the ring is full. Single
+    // producer only.
+    void *reserve();
+    // Queues the record filled in the slot returned by the last reserve()
+    void commit();
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    // used by the telemetry_main
+    void run();
+};
@@ -341,6 +341,26 @@ TEST_F(LmkdTest, batch_procs_oom_score_adj) {
     }
 }
 
+TEST_F(LmkdTest, kill_hist_matches_kill_count) {
+    struct lmk_getkillcnt total_req = {.min_oomadj = 1001, .max_oomadj = 1001};
+    uint64_t counts[LMK_KILLHIST_MAX_BUCKETS];
+    uint64_t sum = 0;
+
+    // Kills might happen between the requests, the histogram sum is between both totals
+    int total_before = lmkd_get_kill_count(sock, &total_req);
+    ASSERT_GE(total_before, 0) << "Failed fetching lmkd kill count";
+    int bucket_cnt = lmkd_get_kill_hist(sock, counts, LMK_KILLHIST_MAX_BUCKETS);
+    ASSERT_GT(bucket_cnt, 0) << "Failed fetching lmkd kill histogram";
+    int total_after = lmkd_get_kill_count(sock, &total_req);
+    ASSERT_GE(total_after, 0) << "Failed fetching lmkd kill count";
+
+    for (int i = 0; i < bucket_cnt; i++) {
+        sum += counts[i];
+    }
+    ASSERT_GE(sum, (uint64_t)total_before);
+    ASSERT_LE(sum, (uint64_t)total_after);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     InitLogging(argv, StderrLogger);
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "name_arena.h"
+
+#define ARENA_MAX_LEN 16
+#define ARENA_SIZE 64
+
+TEST(NameArenaTest, stores_and_truncates_names) {
+    NameArena arena(ARENA_MAX_LEN);
+    int a = arena.store("system_server");
+    int b = arena.store("com.android.very.long.package.name");
+
+    ASSERT_NE(NameArena::INVALID_HANDLE, a);
+    ASSERT_NE(NameArena::INVALID_HANDLE, b);
+    EXPECT_STREQ("system_server", arena.get(a));
+    EXPECT_EQ(std::string("com.android.very.long.package.name", ARENA_MAX_LEN), arena.get(b));
+    EXPECT_EQ(nullptr, arena.get(NameArena::INVALID_HANDLE));
+}
+
+TEST(NameArenaTest, reuses_released_handles) {
+    NameArena arena(ARENA_MAX_LEN);
+    int a = arena.store("first");
+    int b = arena.store("second");
+
+    arena.release(a);
+    // releasing twice or releasing an invalid handle is a no-op
+    arena.release(a);
+    arena.release(NameArena::INVALID_HANDLE);
+    int c = arena.store("third");
+
+    EXPECT_EQ(a, c);
+    EXPECT_STREQ("third", arena.get(c));
+    EXPECT_STREQ("second", arena.get(b));
+}
+
+TEST(NameArenaTest, compacts_released_names) {
+    NameArena arena(ARENA_MAX_LEN);
+    std::vector<int> handles;
+
+    ASSERT_TRUE(arena.reserve(ARENA_SIZE));
+    // fill the buffer with 8 byte entries, keep every fourth one alive
+    for (int i = 0; i < ARENA_SIZE / 8; i++) {
+        handles.push_back(arena.store(("name" + std::to_string(100 + i)).c_str()));
+        ASSERT_NE(NameArena::INVALID_HANDLE, handles.back());
+    }
+    const char *before = arena.get(handles[0]);
+    for (int i = 0; i < ARENA_SIZE / 8; i++) {
+        if (i % 4) {
+            arena.release(handles[i]);
+        }
+    }
+
+    // the buffer is full, so this store reclaims the released names without growing
+    int h = arena.store("new_name");
+    ASSERT_NE(NameArena::INVALID_HANDLE, h);
+    EXPECT_STREQ("new_name", arena.get(h));
+    EXPECT_NE(before, arena.get(handles[0]));
+    EXPECT_STREQ("name100", arena.get(handles[0]));
+    EXPECT_STREQ("name104", arena.get(handles[4]));
+
+    // the compacted buffer has room for the released entries again
+    const char *after = arena.get(handles[0]);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_NE(NameArena::INVALID_HANDLE, arena.store("refill"));
+    }
+    EXPECT_EQ(after, arena.get(handles[0]));
+}
+
+TEST(NameArenaTest, handles_survive_growth) {
+    NameArena arena(ARENA_MAX_LEN);
+    std::vector<int> handles;
+
+    ASSERT_TRUE(arena.reserve(ARENA_SIZE));
+    // live names outgrow the initial buffer several times
+    for (int i = 0; i < ARENA_SIZE; i++) {
+        handles.push_back(arena.store(("proc" + std::to_string(i)).c_str()));
+        ASSERT_NE(NameArena::INVALID_HANDLE, handles.back());
+    }
+    for (int i = 0; i < ARENA_SIZE; i++) {
+        EXPECT_EQ("proc" + std::to_string(i), arena.get(handles[i]));
+    }
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "pid_table.h"
+
+#define PID_MAX 4194304
+#define RANDOM_RECORDS 5000
+#define BENCH_ROUNDS 20
+#define CHAINED_BUCKETS 1024
+
+struct record {
+    int pid;
+    // next record of the bucket in the chained table
+    struct record *next;
+};
+
+// Returns records with distinct random pids
+static std::vector<struct record> make_records(size_t count) {
+    std::unordered_map<int, bool> used;
+    std::vector<struct record> records;
+
+    while (records.size() < count) {
+        int pid = 1 + rand() % (PID_MAX - 1);
+
+        if (used.emplace(pid, true).second) {
+            records.push_back({ pid, nullptr });
+        }
+    }
+    return records;
+}
+
+static long elapsed_ns(const struct timespec& start, const struct timespec& end) {
+    return (end.tv_sec - start.tv_sec) * 1000000000L + end.tv_nsec - start.tv_nsec;
+}
+
+/* The fixed chained hash table used before PidTable */
+class ChainedTable {
+    struct record *buckets_[CHAINED_BUCKETS] = {};
+
+    static int hash(int pid) { return ((pid >> 8) ^ pid) & (CHAINED_BUCKETS - 1); }
+public:
+    void insert(struct record *r) {
+        r->next = buckets_[hash(r->pid)];
+        buckets_[hash(r->pid)] = r;
+    }
+    struct record *find(int pid) {
+        struct record *r = buckets_[hash(pid)];
+
+        while (r && r->pid != pid) {
+            r = r->next;
+        }
+        return r;
+    }
+    struct record *erase(int pid) {
+        struct record **link = &buckets_[hash(pid)];
+        struct record *r;
+
+        while (*link && (*link)->pid != pid) {
+            link = &(*link)->next;
+        }
+        if (!*link) {
+            return nullptr;
+        }
+        r = *link;
+        *link = r->next;
+        return r;
+    }
+};
+
+TEST(PidTableTest, inserts_finds_and_erases) {
+    PidTable<struct record> table;
+    struct record a = { 100, nullptr };
+    struct record b = { 100, nullptr };
+
+    EXPECT_EQ(nullptr, table.find(100));
+    EXPECT_EQ(nullptr, table.erase(100));
+    ASSERT_TRUE(table.insert(a.pid, &a));
+    EXPECT_EQ(&a, table.find(100));
+    // a new record of the same pid replaces the previous one
+    ASSERT_TRUE(table.insert(b.pid, &b));
+    EXPECT_EQ(1u, table.count());
+    EXPECT_EQ(&b, table.find(100));
+    EXPECT_EQ(nullptr, table.find(0));
+    EXPECT_EQ(nullptr, table.find(-100));
+    EXPECT_EQ(&b, table.erase(100));
+    EXPECT_EQ(nullptr, table.find(100));
+    EXPECT_EQ(0u, table.count());
+}
+
+TEST(PidTableTest, keeps_probe_sequences_across_growth_and_erasure) {
+    PidTable<struct record> table;
+    std::vector<struct record> records;
+
+    srand(1);
+    records = make_records(RANDOM_RECORDS);
+    // sequential pids fill neighbouring entries as well
+    for (int pid = 1; pid <= RANDOM_RECORDS; pid++) {
+        records.push_back({ PID_MAX + pid, nullptr });
+    }
+    for (struct record& r : records) {
+        ASSERT_TRUE(table.insert(r.pid, &r));
+    }
+    ASSERT_EQ(records.size(), table.count());
+
+    // erase every other record, the remaining ones must still be found
+    for (size_t i = 0; i < records.size(); i += 2) {
+        ASSERT_EQ(&records[i], table.erase(records[i].pid));
+    }
+    for (size_t i = 0; i < records.size(); i++) {
+        ASSERT_EQ(i % 2 ? &records[i] : nullptr, table.find(records[i].pid)) << records[i].pid;
+    }
+    EXPECT_EQ(records.size() / 2, table.count());
+}
+
+/*
+ * Per operation cost with random pids, compared to the chained table of 1024 buckets, as used
+ * before PidTable. Insertion includes the growth of the table from empty.
+ */
+TEST(PidTableTest, benchmark) {
+    srand(1);
+    for (size_t count : { 1000, 5000, 20000 }) {
+        std::vector<struct record> records = make_records(count);
+        long table_ns[3] = { LONG_MAX, LONG_MAX, LONG_MAX };
+        long chained_ns[3] = { LONG_MAX, LONG_MAX, LONG_MAX };
+        struct timespec start;
+        struct timespec end;
+
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            PidTable<struct record> table;
+            ChainedTable chained;
+            size_t found = 0;
+
+            // insert, then look up in another order, then remove
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (struct record& r : records) {
+                table.insert(r.pid, &r);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            table_ns[0] = std::min(table_ns[0], elapsed_ns(start, end));
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (size_t i = count; i-- > 0;) {
+                found += table.find(records[i].pid) != nullptr;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            table_ns[1] = std::min(table_ns[1], elapsed_ns(start, end));
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (struct record& r : records) {
+                found += table.erase(r.pid) != nullptr;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            table_ns[2] = std::min(table_ns[2], elapsed_ns(start, end));
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (struct record& r : records) {
+                chained.insert(&r);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            chained_ns[0] = std::min(chained_ns[0], elapsed_ns(start, end));
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (size_t i = count; i-- > 0;) {
+                found += chained.find(records[i].pid) != nullptr;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            chained_ns[1] = std::min(chained_ns[1], elapsed_ns(start, end));
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (struct record& r : records) {
+                found += chained.erase(r.pid) != nullptr;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            chained_ns[2] = std::min(chained_ns[2], elapsed_ns(start, end));
+
+            ASSERT_EQ(4 * count, found);
+            ASSERT_EQ(0u, table.count());
+        }
+        printf("%zu processes, ns per register/lookup/remove: pid table %.1f/%.1f/%.1f, "
+               "chained %.1f/%.1f/%.1f\n", count, (double)table_ns[0] / count,
+               (double)table_ns[1] / count, (double)table_ns[2] / count,
+               (double)chained_ns[0] / count, (double)chained_ns[1] / count,
+               (double)chained_ns[2] / count);
+    }
+}
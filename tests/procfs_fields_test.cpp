@@ -0,0 +1,236 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "procfs_fields.h"
+#include "vmstat_captures.h"
+
+#define BENCH_ROUNDS 2000
+
+struct vmstat_capture {
+    const char *kernel;
+    const char *data;
+};
+
+static const struct vmstat_capture vmstat_captures[] = {
+    { "4.19", vmstat_4_19 },
+    { "5.10", vmstat_5_10 },
+    { "6.x", vmstat_6_x },
+};
+
+// Reference parser: looks every line up in the whole file, no layout and no early exit
+static void vmstat_parse_all(const char *buf, int64_t *fields) {
+    std::string data(buf);
+    size_t pos = 0;
+
+    memset(fields, 0, sizeof(int64_t) * VS_FIELD_COUNT);
+    while (pos < data.size()) {
+        size_t end = data.find('\n', pos);
+        std::string line = data.substr(pos, end == std::string::npos ? std::string::npos
+                                                                     : end - pos);
+        size_t space = line.find(' ');
+
+        for (int i = 0; space != std::string::npos && i < VS_FIELD_COUNT; i++) {
+            if (line.compare(0, space, vmstat_field_names[i]) == 0) {
+                fields[i] = strtoll(line.c_str() + space + 1, NULL, 10);
+            }
+        }
+        if (end == std::string::npos) {
+            break;
+        }
+        pos = end + 1;
+    }
+}
+
+static long elapsed_ns(const struct timespec& start, const struct timespec& end) {
+    return (end.tv_sec - start.tv_sec) * 1000000000L + end.tv_nsec - start.tv_nsec;
+}
+
+// Field lookup by comparing the name against every entry, as done before field_index
+template <int N>
+static int find_field_linear(const char *name, const char* const (&names)[N]) {
+    for (int i = 0; i < N; i++) {
+        if (!strcmp(name, names[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Returns the field names of every line of the buffer
+static std::vector<std::string> line_names(const char *buf) {
+    std::vector<std::string> names;
+
+    for (const char *line = buf; *line;) {
+        const char *end = strchr(line, '\n');
+
+        names.emplace_back(line, strcspn(line, " "));
+        if (!end) {
+            break;
+        }
+        line = end + 1;
+    }
+    return names;
+}
+
+TEST(ProcfsFieldsTest, field_index_finds_every_field) {
+    for (int i = 0; i < MI_FIELD_COUNT; i++) {
+        EXPECT_EQ(i, meminfo_field_index.find(meminfo_field_names[i]));
+    }
+    for (int i = 0; i < VS_FIELD_COUNT; i++) {
+        EXPECT_EQ(i, vmstat_field_index.find(vmstat_field_names[i]));
+    }
+    // same results as the linear lookup for every line of the captures, wanted or not
+    for (const struct vmstat_capture& capture : vmstat_captures) {
+        for (const std::string& name : line_names(capture.data)) {
+            EXPECT_EQ(find_field_linear(name.c_str(), vmstat_field_names),
+                      vmstat_field_index.find(name.c_str(), name.size()))
+                    << name;
+        }
+    }
+    // prefixes and extensions of a name do not match
+    EXPECT_EQ(-1, meminfo_field_index.find("MemFree"));
+    EXPECT_EQ(-1, vmstat_field_index.find("nr_free_pages_blocks"));
+    EXPECT_EQ(-1, vmstat_field_index.find("pgscan", strlen("pgscan")));
+}
+
+TEST(ProcfsFieldsTest, field_lookup_benchmark) {
+    std::vector<std::string> names = line_names(vmstat_6_x);
+    struct timespec start;
+    struct timespec end;
+    long linear_ns;
+    long index_ns;
+    int found = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        for (const std::string& name : names) {
+            found += find_field_linear(name.c_str(), vmstat_field_names) >= 0;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    linear_ns = elapsed_ns(start, end) / BENCH_ROUNDS;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        for (const std::string& name : names) {
+            found -= vmstat_field_index.find(name.c_str(), name.size()) >= 0;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    index_ns = elapsed_ns(start, end) / BENCH_ROUNDS;
+
+    EXPECT_EQ(0, found);
+    printf("lookup of %zu vmstat names: linear %ldns, field_index %ldns\n", names.size(),
+           linear_ns, index_ns);
+}
+
+TEST(ProcfsFieldsTest, vmstat_captures_parse_like_full_scan) {
+    for (const struct vmstat_capture& capture : vmstat_captures) {
+        struct field_layout layout = {};
+        int64_t expected[VS_FIELD_COUNT];
+        int64_t fields[VS_FIELD_COUNT] = {};
+
+        SCOPED_TRACE(capture.kernel);
+        vmstat_parse_all(capture.data, expected);
+        // the full parse learns the layout, the second one uses it
+        for (int pass = 0; pass < 2; pass++) {
+            ASSERT_EQ(0, parse_fields(capture.data, vmstat_field_index, &layout, fields,
+                                      vmstat_field_groups));
+            EXPECT_EQ(0, memcmp(expected, fields, sizeof(fields)));
+        }
+        // the refault counter is found under either name
+        EXPECT_NE(0, layout.count);
+        EXPECT_EQ(expected[VS_WORKINGSET_REFAULT] ? : expected[VS_WORKINGSET_REFAULT_FILE],
+                  fields[VS_WORKINGSET_REFAULT] ? : fields[VS_WORKINGSET_REFAULT_FILE]);
+    }
+}
+
+TEST(ProcfsFieldsTest, vmstat_parse_stops_after_renamed_counters) {
+    for (const struct vmstat_capture& capture : vmstat_captures) {
+        struct field_layout layout = {};
+        int64_t expected[VS_FIELD_COUNT];
+        int64_t fields[VS_FIELD_COUNT] = {};
+        // counters past the last wanted one must not be looked at
+        std::string data = std::string(capture.data) + "pgrefill 123456789\n";
+
+        SCOPED_TRACE(capture.kernel);
+        vmstat_parse_all(capture.data, expected);
+        ASSERT_EQ(0, parse_fields(data.c_str(), vmstat_field_index, &layout, fields,
+                                  vmstat_field_groups));
+        EXPECT_EQ(expected[VS_PGREFILL], fields[VS_PGREFILL]);
+    }
+}
+
+TEST(ProcfsFieldsTest, vmstat_parse_relearns_changed_layout) {
+    struct field_layout layout = {};
+    int64_t fields[VS_FIELD_COUNT] = {};
+    int64_t expected[VS_FIELD_COUNT];
+
+    ASSERT_EQ(0, parse_fields(vmstat_4_19, vmstat_field_index, &layout, fields,
+                              vmstat_field_groups));
+    // a newer kernel layout after the 4.19 one was learned, cleared like vmstat_parse() does
+    vmstat_parse_all(vmstat_5_10, expected);
+    memset(fields, 0, sizeof(fields));
+    ASSERT_EQ(0, parse_fields(vmstat_5_10, vmstat_field_index, &layout, fields,
+                              vmstat_field_groups));
+    EXPECT_EQ(0, memcmp(expected, fields, sizeof(fields)));
+}
+
+TEST(ProcfsFieldsTest, vmstat_parse_benchmark) {
+    for (const struct vmstat_capture& capture : vmstat_captures) {
+        struct field_layout layout = {};
+        int64_t fields[VS_FIELD_COUNT];
+        struct timespec start;
+        struct timespec end;
+        long all_ns;
+        long full_ns;
+        long layout_ns;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < BENCH_ROUNDS; i++) {
+            vmstat_parse_all(capture.data, fields);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        all_ns = elapsed_ns(start, end) / BENCH_ROUNDS;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < BENCH_ROUNDS; i++) {
+            layout.count = 0;
+            parse_fields(capture.data, vmstat_field_index, &layout, fields, vmstat_field_groups);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        full_ns = elapsed_ns(start, end) / BENCH_ROUNDS;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < BENCH_ROUNDS; i++) {
+            parse_fields(capture.data, vmstat_field_index, &layout, fields, vmstat_field_groups);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        layout_ns = elapsed_ns(start, end) / BENCH_ROUNDS;
+
+        printf("vmstat %s: reference scan %ldns, early exit %ldns, learned layout %ldns\n",
+               capture.kernel, all_ns, full_ns, layout_ns);
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define PROCFS_SCAN_SCALAR
+
+#include "procfs_scan_scalar.h"
+
+const char *scalar_scan_line_end(const char *str) {
+    return scan_line_end(str);
+}
+
+const char *scalar_scan_digits(const char *str) {
+    return scan_digits(str);
+}
+
+const char *scalar_scan_int64(const char *str, int64_t *ret) {
+    return scan_int64(str, ret);
+}
+
+int scalar_parse_vmstat(const char *buf, struct field_layout *layout, int64_t *fields) {
+    return parse_fields(buf, vmstat_field_index, layout, fields, vmstat_field_groups);
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "procfs_fields.h"
+
+/*
+ * The procfs scanners built with PROCFS_SCAN_SCALAR, to check the vector scanners the rest of the
+ * tests are built with against them.
+ */
+const char *scalar_scan_line_end(const char *str);
+const char *scalar_scan_digits(const char *str);
+const char *scalar_scan_int64(const char *str, int64_t *ret);
+int scalar_parse_vmstat(const char *buf, struct field_layout *layout, int64_t *fields);
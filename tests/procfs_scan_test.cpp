@@ -0,0 +1,179 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include "procfs_fields.h"
+#include "procfs_scan_scalar.h"
+#include "vmstat_captures.h"
+
+/*
+ * The scanners of this file are the vector ones of the target (SSE2 on x86, NEON on arm64, the
+ * latter run by the arm64 presubmit), compared with the scalar build of the same code.
+ */
+#if defined(PROCFS_SCAN_SSE2)
+#define SCAN_VECTOR_NAME "SSE2"
+#elif defined(PROCFS_SCAN_NEON)
+#define SCAN_VECTOR_NAME "NEON"
+#else
+#define SCAN_VECTOR_NAME "scalar"
+#endif
+
+#define RANDOM_ROUNDS 1000
+#define RANDOM_MAX_LEN 64
+#define BENCH_ROUNDS 2000
+
+static const char* const vmstat_files[] = { vmstat_4_19, vmstat_5_10, vmstat_6_x };
+
+// bytes the scanners treat differently, including non-ASCII ones
+static const char random_chars[] = "0123456789\n\t -+:/a\x80\xff";
+
+static long elapsed_ns(const struct timespec& start, const struct timespec& end) {
+    return (end.tv_sec - start.tv_sec) * 1000000000L + end.tv_nsec - start.tv_nsec;
+}
+
+// Checks both builds of the scanners at every position of a NUL-terminated buffer
+static void expect_same_scans(const char *buf) {
+    for (const char *str = buf;; str++) {
+        int64_t val = 0;
+        int64_t scalar_val = 0;
+        const char *end = scan_int64(str, &val);
+
+        ASSERT_EQ(scalar_scan_line_end(str), scan_line_end(str)) << "at " << str - buf;
+        ASSERT_EQ(scalar_scan_digits(str), scan_digits(str)) << "at " << str - buf;
+        ASSERT_EQ(scalar_scan_int64(str, &scalar_val), end) << "at " << str - buf;
+        if (end) {
+            ASSERT_EQ(scalar_val, val) << "at " << str - buf;
+        }
+        if (!*str) {
+            break;
+        }
+    }
+}
+
+TEST(ProcfsScanTest, scans_match_scalar_on_random_buffers) {
+    // the alignment of the buffer start varies with the block offset of each position
+    alignas(PROCFS_SCAN_BLOCK) char buf[RANDOM_MAX_LEN + PROCFS_SCAN_BLOCK];
+
+    srand(1);
+    for (int round = 0; round < RANDOM_ROUNDS; round++) {
+        int len = rand() % RANDOM_MAX_LEN;
+
+        for (int i = 0; i < len; i++) {
+            buf[i] = random_chars[rand() % (sizeof(random_chars) - 1)];
+        }
+        buf[len] = '\0';
+        SCOPED_TRACE(round);
+        expect_same_scans(buf);
+    }
+}
+
+TEST(ProcfsScanTest, scan_int64_matches_scalar_on_limits) {
+    static const char* const numbers[] = {
+        "0", "-0", "+7", " \t42 kB", "-", "+", "", "x1", "1x",
+        "9223372036854775807", "-9223372036854775808",
+        "9223372036854775808", "-9223372036854775809",
+        "0000000000000000001", "00000000000000000001", "18446744073709551616",
+    };
+    alignas(PROCFS_SCAN_BLOCK) char buf[2 * PROCFS_SCAN_BLOCK + 32];
+
+    for (const char *number : numbers) {
+        // every start offset within a block, so that numbers cross block boundaries
+        for (size_t offset = 0; offset < PROCFS_SCAN_BLOCK; offset++) {
+            strcpy(buf + offset, number);
+            SCOPED_TRACE(number);
+            expect_same_scans(buf + offset);
+        }
+    }
+}
+
+TEST(ProcfsScanTest, scans_match_scalar_on_captures) {
+    for (const char *file : vmstat_files) {
+        struct field_layout layout = {};
+        struct field_layout scalar_layout = {};
+        int64_t fields[VS_FIELD_COUNT] = {};
+        int64_t scalar_fields[VS_FIELD_COUNT] = {};
+
+        expect_same_scans(file);
+        // the full parse, then the one with the learned layout
+        for (int pass = 0; pass < 2; pass++) {
+            ASSERT_EQ(scalar_parse_vmstat(file, &scalar_layout, scalar_fields),
+                      parse_fields(file, vmstat_field_index, &layout, fields,
+                                   vmstat_field_groups));
+            EXPECT_EQ(0, memcmp(scalar_fields, fields, sizeof(fields)));
+            EXPECT_EQ(scalar_layout.count, layout.count);
+        }
+    }
+}
+
+TEST(ProcfsScanTest, scan_benchmark) {
+    long scalar_lines_ns = LONG_MAX;
+    long lines_ns = LONG_MAX;
+    long scalar_parse_ns = LONG_MAX;
+    long parse_ns = LONG_MAX;
+    int64_t fields[VS_FIELD_COUNT];
+    struct timespec start;
+    struct timespec end;
+    size_t lines = 0;
+
+    // the whole 6.x file line by line, then a full parse up to the last wanted counter
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        struct field_layout layout = {};
+        size_t count = 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (const char *line = vmstat_6_x; *line; count++) {
+            line = scalar_scan_line_end(line);
+            line += *line != '\0';
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        scalar_lines_ns = std::min(scalar_lines_ns, elapsed_ns(start, end));
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (const char *line = vmstat_6_x; *line; count--) {
+            line = scan_line_end(line);
+            line += *line != '\0';
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        lines_ns = std::min(lines_ns, elapsed_ns(start, end));
+        ASSERT_EQ(0u, count);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        scalar_parse_vmstat(vmstat_6_x, &layout, fields);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        scalar_parse_ns = std::min(scalar_parse_ns, elapsed_ns(start, end));
+
+        layout.count = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        parse_fields(vmstat_6_x, vmstat_field_index, &layout, fields, vmstat_field_groups);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        parse_ns = std::min(parse_ns, elapsed_ns(start, end));
+    }
+    for (const char *line = vmstat_6_x; *line; lines++) {
+        line = scan_line_end(line);
+        line += *line != '\0';
+    }
+    printf("vmstat 6.x, %zu lines: line scan scalar %ldns, %s %ldns; "
+           "full parse scalar %ldns, %s %ldns\n", lines, scalar_lines_ns, SCAN_VECTOR_NAME,
+           lines_ns, scalar_parse_ns, SCAN_VECTOR_NAME, parse_ns);
+}
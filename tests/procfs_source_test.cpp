@@ -0,0 +1,175 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <set>
+#include <string>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <psi/psi.h>
+
+#include "procfs_source.h"
+
+using namespace android::base;
+
+#define FIXTURE_MEMINFO "MemTotal:        4000000 kB\nMemFree:          100000 kB\n"
+#define FIXTURE_STATUS "Name:\tfixture_app\nTgid:\t1234\nVmRSS:\t   20480 kB\n"
+#define FIXTURE_PSI_MEMORY                                  \
+    "some avg10=1.50 avg60=0.75 avg300=0.10 total=400000\n" \
+    "full avg10=0.80 avg60=0.25 avg300=0.05 total=200000\n"
+// the same file a second later, after 250ms of complete stall
+#define FIXTURE_PSI_MEMORY_LATER                            \
+    "some avg10=9.00 avg60=2.50 avg300=0.60 total=900000\n" \
+    "full avg10=4.20 avg60=1.10 avg300=0.25 total=450000\n"
+
+// Lays out a small /proc and /sys snapshot the way lmkd expects to find it
+class ProcfsSourceTest : public ::testing::Test {
+  public:
+    virtual void SetUp() {
+        root_ = fixture_.path;
+        ASSERT_TRUE(MakeDir("/proc"));
+        ASSERT_TRUE(MakeDir("/proc/1234"));
+        ASSERT_TRUE(MakeDir("/proc/pressure"));
+        ASSERT_TRUE(MakeDir("/sys"));
+        ASSERT_TRUE(MakeDir("/sys/devices"));
+        ASSERT_TRUE(MakeDir("/sys/devices/system"));
+        ASSERT_TRUE(MakeDir("/sys/devices/system/node"));
+        ASSERT_TRUE(MakeDir("/sys/devices/system/node/node0"));
+        ASSERT_TRUE(MakeDir("/sys/devices/system/node/node1"));
+        ASSERT_TRUE(WriteStringToFile(FIXTURE_MEMINFO, root_ + "/proc/meminfo"));
+        ASSERT_TRUE(WriteStringToFile(FIXTURE_STATUS, root_ + "/proc/1234/status"));
+        ASSERT_TRUE(WriteStringToFile(FIXTURE_PSI_MEMORY, root_ + "/proc/pressure/memory"));
+        ASSERT_TRUE(procfs_set_root(root_.c_str()));
+    }
+
+    virtual void TearDown() { procfs_set_root(NULL); }
+
+  protected:
+    bool MakeDir(const char *path) { return mkdir((root_ + path).c_str(), 0700) == 0; }
+
+    std::string ReadResolved(const char *path) {
+        std::string content;
+        int fd = procfs_open(path, O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0) {
+            return "";
+        }
+        ReadFdToString(fd, &content);
+        close(fd);
+        return content;
+    }
+
+    // Parses a pressure file the way lmkd does, the "full" line is optional
+    bool ParsePressure(const char *path, struct psi_stats stats[]) {
+        std::string content = ReadResolved(path);
+        char *save_ptr;
+        char *line;
+
+        line = strtok_r(content.data(), "\n", &save_ptr);
+        if (parse_psi_line(line, PSI_SOME, stats)) {
+            return false;
+        }
+        line = strtok_r(NULL, "\n", &save_ptr);
+        return !line || !parse_psi_line(line, PSI_FULL, stats);
+    }
+
+    TemporaryDir fixture_;
+    std::string root_;
+};
+
+TEST_F(ProcfsSourceTest, reads_fixture_files) {
+    EXPECT_STREQ(root_.c_str(), procfs_root());
+    EXPECT_EQ(FIXTURE_MEMINFO, ReadResolved("/proc/meminfo"));
+    EXPECT_EQ(FIXTURE_STATUS, ReadResolved("/proc/1234/status"));
+    EXPECT_EQ(0, procfs_access("/proc/1234/status", R_OK));
+    EXPECT_NE(0, procfs_access("/proc/1/status", F_OK));
+}
+
+TEST_F(ProcfsSourceTest, lists_fixture_nodes) {
+    std::set<std::string> names;
+    DIR *dir = procfs_opendir("/sys/devices/system/node");
+    struct dirent *de;
+
+    ASSERT_NE(nullptr, dir);
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] != '.') {
+            names.insert(de->d_name);
+        }
+    }
+    closedir(dir);
+    EXPECT_EQ((std::set<std::string>{"node0", "node1"}), names);
+}
+
+TEST_F(ProcfsSourceTest, writes_are_not_redirected) {
+    errno = 0;
+    EXPECT_EQ(-1, procfs_open("/proc/1234/status", O_WRONLY | O_CLOEXEC));
+    EXPECT_EQ(EINVAL, errno);
+    errno = 0;
+    EXPECT_EQ(-1, procfs_access("/proc/1234/status", W_OK));
+    EXPECT_EQ(EINVAL, errno);
+}
+
+TEST_F(ProcfsSourceTest, root_can_be_reset) {
+    char path[PATH_MAX];
+
+    // trailing slashes are ignored
+    ASSERT_TRUE(procfs_set_root((root_ + "//").c_str()));
+    ASSERT_TRUE(procfs_path(path, sizeof(path), "/proc/meminfo"));
+    EXPECT_EQ(root_ + "/proc/meminfo", path);
+    EXPECT_EQ(FIXTURE_MEMINFO, ReadResolved("/proc/meminfo"));
+
+    ASSERT_TRUE(procfs_set_root(NULL));
+    EXPECT_STREQ("", procfs_root());
+    ASSERT_TRUE(procfs_path(path, sizeof(path), "/proc/meminfo"));
+    EXPECT_STREQ("/proc/meminfo", path);
+}
+
+TEST_F(ProcfsSourceTest, parses_fixture_pressure) {
+    const char *path = psi_resource_file[PSI_MEMORY];
+    struct psi_stats stats[PSI_TYPE_COUNT] = {};
+    struct psi_stall_rate rate;
+    struct timespec tm = { .tv_sec = 100, .tv_nsec = 0 };
+
+    ASSERT_TRUE(ParsePressure(path, stats));
+    EXPECT_FLOAT_EQ(1.5f, stats[PSI_SOME].avg10);
+    EXPECT_FLOAT_EQ(0.1f, stats[PSI_SOME].avg300);
+    EXPECT_EQ(400000UL, stats[PSI_SOME].total);
+    EXPECT_FLOAT_EQ(0.8f, stats[PSI_FULL].avg10);
+    EXPECT_EQ(200000UL, stats[PSI_FULL].total);
+
+    // the stall rate needs a complete window
+    psi_stall_rate_init(&rate, 1000);
+    EXPECT_EQ(-1, psi_stall_rate_update(&rate, stats[PSI_FULL].total, &tm));
+
+    ASSERT_TRUE(WriteStringToFile(FIXTURE_PSI_MEMORY_LATER, root_ + path));
+    ASSERT_TRUE(ParsePressure(path, stats));
+    EXPECT_EQ(450000UL, stats[PSI_FULL].total);
+    tm.tv_sec++;
+    EXPECT_FLOAT_EQ(25.0f, psi_stall_rate_update(&rate, stats[PSI_FULL].total, &tm));
+}
+
+TEST_F(ProcfsSourceTest, rejects_malformed_pressure) {
+    struct psi_stats stats[PSI_TYPE_COUNT] = {};
+
+    ASSERT_TRUE(WriteStringToFile("some avg10=1.50 avg60=0.75\n", root_ + "/proc/pressure/memory"));
+    EXPECT_FALSE(ParsePressure(psi_resource_file[PSI_MEMORY], stats));
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "registrants.h"
+
+#define MAX_REGISTRANTS 3
+#define BENCH_RECORDS 10000
+#define BENCH_OWN_RECORDS 8
+#define BENCH_ROUNDS 100
+
+static std::vector<Registrants::node> make_records(size_t count, pid_t reg_pid) {
+    std::vector<Registrants::node> records(count);
+
+    for (Registrants::node& record : records) {
+        record.reg_pid = reg_pid;
+    }
+    return records;
+}
+
+// Purges the records of pid, returns the purged records.
+static std::vector<Registrants::node*> purge(Registrants& regs, pid_t pid) {
+    std::vector<Registrants::node*> purged;
+
+    regs.purge(pid, [&](Registrants::node *node) {
+        regs.remove(node);
+        purged.push_back(node);
+    });
+    return purged;
+}
+
+static bool purged(const std::vector<Registrants::node*>& nodes, Registrants::node *node) {
+    return std::find(nodes.begin(), nodes.end(), node) != nodes.end();
+}
+
+static long elapsed_ns(const struct timespec& start, const struct timespec& end) {
+    return (end.tv_sec - start.tv_sec) * 1000000000L + end.tv_nsec - start.tv_nsec;
+}
+
+TEST(RegistrantsTest, purges_own_and_unclaimed_records) {
+    Registrants regs(MAX_REGISTRANTS);
+    std::vector<Registrants::node> a = make_records(2, 100);
+    std::vector<Registrants::node> b = make_records(2, 200);
+    std::vector<Registrants::node> unclaimed = make_records(1, 0);
+
+    for (auto *records : { &a, &b, &unclaimed }) {
+        for (Registrants::node& record : *records) {
+            regs.insert(&record);
+        }
+    }
+    std::vector<Registrants::node*> nodes = purge(regs, 100);
+
+    EXPECT_EQ(3u, nodes.size());
+    EXPECT_TRUE(purged(nodes, &a[0]));
+    EXPECT_TRUE(purged(nodes, &a[1]));
+    EXPECT_TRUE(purged(nodes, &unclaimed[0]));
+    EXPECT_EQ(2u, purge(regs, 200).size());
+}
+
+TEST(RegistrantsTest, releases_and_claims_records) {
+    Registrants regs(MAX_REGISTRANTS);
+    std::vector<Registrants::node> a = make_records(2, 100);
+
+    for (Registrants::node& record : a) {
+        regs.insert(&record);
+    }
+    // records of another registrant can't be claimed until it goes away
+    EXPECT_FALSE(regs.claim(&a[0], 200));
+    EXPECT_TRUE(regs.claim(&a[0], 100));
+    regs.release(100);
+    EXPECT_EQ(0, a[0].reg_pid);
+    EXPECT_EQ(0, a[1].reg_pid);
+    EXPECT_TRUE(regs.claim(&a[0], 200));
+    EXPECT_EQ(200, a[0].reg_pid);
+
+    std::vector<Registrants::node*> nodes = purge(regs, 200);
+    EXPECT_EQ(2u, nodes.size());
+}
+
+TEST(RegistrantsTest, registers_beyond_max_registrants) {
+    Registrants regs(MAX_REGISTRANTS);
+    std::vector<std::vector<Registrants::node>> records;
+
+    for (pid_t pid = 100; pid < 100 + MAX_REGISTRANTS + 2; pid++) {
+        records.push_back(make_records(2, pid));
+    }
+    for (auto& registrant_records : records) {
+        for (Registrants::node& record : registrant_records) {
+            regs.insert(&record);
+        }
+    }
+
+    // registrants without an entry keep their records and only they can purge them
+    std::vector<Registrants::node*> nodes = purge(regs, 100);
+    EXPECT_EQ(2u, nodes.size());
+    EXPECT_FALSE(regs.claim(&records[MAX_REGISTRANTS][0], 100));
+    nodes = purge(regs, 100 + MAX_REGISTRANTS);
+    EXPECT_EQ(2u, nodes.size());
+    EXPECT_TRUE(purged(nodes, &records[MAX_REGISTRANTS][0]));
+    EXPECT_TRUE(purged(nodes, &records[MAX_REGISTRANTS][1]));
+
+    // once released they are unclaimed and purged by anyone
+    regs.release(100 + MAX_REGISTRANTS + 1);
+    EXPECT_EQ(0, records[MAX_REGISTRANTS + 1][0].reg_pid);
+    nodes = purge(regs, 101);
+    EXPECT_EQ(4u, nodes.size());
+}
+
+/*
+ * Purge of a registrant with a few records among 10k records, compared to a sweep of every
+ * record, as done before records were listed per registrant.
+ */
+TEST(RegistrantsTest, purge_benchmark) {
+    Registrants regs(MAX_REGISTRANTS);
+    std::vector<Registrants::node> own = make_records(BENCH_OWN_RECORDS, 100);
+    std::vector<Registrants::node> others =
+            make_records(BENCH_RECORDS - BENCH_OWN_RECORDS, 200);
+    long purge_ns = LONG_MAX;
+    long sweep_ns = LONG_MAX;
+    struct timespec start;
+    struct timespec end;
+
+    for (size_t i = 0; i < others.size(); i++) {
+        others[i].reg_pid = i % 2 ? 200 : 300;
+        regs.insert(&others[i]);
+    }
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        size_t count = 0;
+
+        for (Registrants::node& record : own) {
+            regs.insert(&record);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        regs.purge(100, [&](Registrants::node *node) {
+            regs.remove(node);
+            count++;
+        });
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ASSERT_EQ((size_t)BENCH_OWN_RECORDS, count);
+        purge_ns = std::min(purge_ns, elapsed_ns(start, end));
+
+        count = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (const Registrants::node& record : others) {
+            count += record.reg_pid == 100;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ASSERT_EQ(0u, count);
+        sweep_ns = std::min(sweep_ns, elapsed_ns(start, end));
+    }
+    printf("%d records: purge of %d records %ldns, sweep %ldns\n", BENCH_RECORDS,
+           BENCH_OWN_RECORDS, purge_ns, sweep_ns);
+    EXPECT_LT(purge_ns, sweep_ns);
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "telemetry.h"
+
+#define RING_SIZE 4
+#define BATCH_COUNT 16
+#define REPORT_TIMEOUT std::chrono::seconds(5)
+
+struct test_record {
+    uint32_t seq;
+    char payload[60];
+};
+
+// The telemetry thread never exits, so the callbacks can't capture per test state
+static std::mutex report_lock;
+static std::condition_variable report_cond;
+static std::vector<uint32_t> reported;
+static uint64_t reported_drops;
+// while set the telemetry thread blocks in the report callback
+static bool report_blocked;
+
+static void report_record(void *record) {
+    std::unique_lock<std::mutex> lock(report_lock);
+
+    report_cond.wait(lock, [] { return !report_blocked; });
+    reported.push_back(static_cast<struct test_record*>(record)->seq);
+    report_cond.notify_all();
+}
+
+static void report_drops(uint64_t dropped) {
+    std::lock_guard<std::mutex> lock(report_lock);
+
+    reported_drops += dropped;
+    report_cond.notify_all();
+}
+
+class TelemetryTest : public ::testing::Test {
+  public:
+    virtual void SetUp() {
+        std::lock_guard<std::mutex> lock(report_lock);
+
+        reported.clear();
+        reported_drops = 0;
+        report_blocked = false;
+        // the thread keeps using the ring after the test ends
+        telemetry_ = new Telemetry(sizeof(struct test_record), report_record, report_drops);
+    }
+
+  protected:
+    bool Push(uint32_t seq) {
+        struct test_record *rec = static_cast<struct test_record*>(telemetry_->reserve());
+
+        if (!rec) {
+            return false;
+        }
+        rec->seq = seq;
+        telemetry_->commit();
+        return true;
+    }
+
+    bool WaitForReports(size_t count) {
+        std::unique_lock<std::mutex> lock(report_lock);
+
+        return report_cond.wait_for(lock, REPORT_TIMEOUT,
+                                    [count] { return reported.size() >= count; });
+    }
+
+    void SetBlocked(bool blocked) {
+        std::lock_guard<std::mutex> lock(report_lock);
+
+        report_blocked = blocked;
+        report_cond.notify_all();
+    }
+
+    Telemetry *telemetry_;
+};
+
+TEST_F(TelemetryTest, disabled_before_init) {
+    EXPECT_FALSE(telemetry_->is_enabled());
+    ASSERT_TRUE(telemetry_->init(RING_SIZE));
+    EXPECT_TRUE(telemetry_->is_enabled());
+    EXPECT_FALSE(telemetry_->init(RING_SIZE));
+}
+
+TEST_F(TelemetryTest, reports_in_order) {
+    ASSERT_TRUE(telemetry_->init(RING_SIZE));
+    // the last reported record may still hold its slot, so leave room for it
+    for (uint32_t seq = 0; seq < BATCH_COUNT * (RING_SIZE - 1); seq++) {
+        if (seq % (RING_SIZE - 1) == 0) {
+            ASSERT_TRUE(WaitForReports(seq));
+        }
+        ASSERT_TRUE(Push(seq));
+    }
+    ASSERT_TRUE(WaitForReports(BATCH_COUNT * (RING_SIZE - 1)));
+
+    std::lock_guard<std::mutex> lock(report_lock);
+    for (uint32_t seq = 0; seq < BATCH_COUNT * (RING_SIZE - 1); seq++) {
+        EXPECT_EQ(seq, reported[seq]);
+    }
+    EXPECT_EQ(0u, reported_drops);
+    EXPECT_EQ(0u, telemetry_->dropped());
+}
+
+TEST_F(TelemetryTest, drops_records_when_full) {
+    // capacity is rounded up to RING_SIZE
+    ASSERT_TRUE(telemetry_->init(RING_SIZE - 1));
+    SetBlocked(true);
+    // the record being reported keeps its slot until the report returns
+    for (uint32_t seq = 0; seq < RING_SIZE; seq++) {
+        ASSERT_TRUE(Push(seq));
+    }
+    EXPECT_FALSE(Push(RING_SIZE));
+    EXPECT_FALSE(Push(RING_SIZE + 1));
+    EXPECT_EQ(2u, telemetry_->dropped());
+
+    SetBlocked(false);
+    ASSERT_TRUE(WaitForReports(RING_SIZE));
+    // the ring accepts records again once the thread caught up, the last slot may still be in use
+    ASSERT_TRUE(Push(RING_SIZE + 2));
+    ASSERT_TRUE(WaitForReports(RING_SIZE + 1));
+
+    std::lock_guard<std::mutex> lock(report_lock);
+    EXPECT_EQ((std::vector<uint32_t>{0, 1, 2, 3, RING_SIZE + 2}), reported);
+    // drops are reported after the next record
+    EXPECT_EQ(2u, reported_drops);
+}
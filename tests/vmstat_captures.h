@@ -0,0 +1,447 @@
+/*
+ * Copyright 2026 Google, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/*
+ * /proc/vmstat of different kernels. The 4.19 and 5.10 files follow the vmstat_text tables of
+ * those kernels with the counters of an arm64 Android configuration and made up values. The 6.x
+ * file is a capture of an idle x86-64 host.
+ */
+
+/* 4.19 arm64, CONFIG_ZSMALLOC, Android ION/GPU counters and speculative faults */
+static const char vmstat_4_19[] =
+        "nr_free_pages 640\n"
+        "nr_zone_inactive_anon 4749300\n"
+        "nr_zone_active_anon 734\n"
+        "nr_zone_inactive_file 714\n"
+        "nr_zone_active_file 7781223\n"
+        "nr_zone_unevictable 828\n"
+        "nr_zone_write_pending 1084571\n"
+        "nr_mlock 7049951\n"
+        "nr_page_table_pages 5699189\n"
+        "nr_kernel_stack 194\n"
+        "nr_bounce 973\n"
+        "nr_zspages 500\n"
+        "nr_free_cma 252807\n"
+        "nr_inactive_anon 5486643\n"
+        "nr_active_anon 9620193\n"
+        "nr_inactive_file 800\n"
+        "nr_active_file 222\n"
+        "nr_unevictable 965\n"
+        "nr_slab_reclaimable 2019540\n"
+        "nr_slab_unreclaimable 56\n"
+        "nr_isolated_anon 8129371\n"
+        "nr_isolated_file 186\n"
+        "workingset_refault 5764987\n"
+        "workingset_activate 9376489\n"
+        "workingset_restore 779\n"
+        "workingset_nodereclaim 26\n"
+        "nr_anon_pages 2232688\n"
+        "nr_mapped 70\n"
+        "nr_file_pages 364\n"
+        "nr_dirty 166\n"
+        "nr_writeback 548\n"
+        "nr_writeback_temp 63\n"
+        "nr_shmem 752\n"
+        "nr_shmem_hugepages 271\n"
+        "nr_shmem_pmdmapped 234\n"
+        "nr_anon_transparent_hugepages 424\n"
+        "nr_unstable 7649260\n"
+        "nr_vmscan_write 747\n"
+        "nr_vmscan_immediate_reclaim 8300712\n"
+        "nr_dirtied 611\n"
+        "nr_written 8387465\n"
+        "nr_kernel_misc_reclaimable 9101569\n"
+        "nr_unreclaimable_pages 1662931\n"
+        "nr_ion_heap 812\n"
+        "nr_ion_heap_pool 307\n"
+        "nr_gpu_heap 488\n"
+        "nr_dirty_threshold 240\n"
+        "nr_dirty_background_threshold 2254499\n"
+        "pgpgin 5186601\n"
+        "pgpgout 134\n"
+        "pgpgoutclean 5692760\n"
+        "pswpin 9830764\n"
+        "pswpout 6988799\n"
+        "pgalloc_dma 239\n"
+        "pgalloc_normal 521\n"
+        "pgalloc_movable 1553323\n"
+        "allocstall_dma 9559133\n"
+        "allocstall_normal 407\n"
+        "allocstall_movable 1408584\n"
+        "pgskip_dma 1547514\n"
+        "pgskip_normal 654\n"
+        "pgskip_movable 100\n"
+        "pgfree 136\n"
+        "pgactivate 4106234\n"
+        "pgdeactivate 2229030\n"
+        "pglazyfree 9215386\n"
+        "pgfault 177\n"
+        "pgmajfault 4\n"
+        "pglazyfreed 935590\n"
+        "pgrefill 2563952\n"
+        "pgsteal_kswapd 407\n"
+        "pgsteal_direct 205\n"
+        "pgscan_kswapd 608\n"
+        "pgscan_direct 1516070\n"
+        "pgscan_direct_throttle 480\n"
+        "pginodesteal 706\n"
+        "slabs_scanned 423\n"
+        "kswapd_inodesteal 5362317\n"
+        "kswapd_low_wmark_hit_quickly 324\n"
+        "kswapd_high_wmark_hit_quickly 169054\n"
+        "pageoutrun 3324792\n"
+        "pgrotated 40999\n"
+        "drop_pagecache 139\n"
+        "drop_slab 536557\n"
+        "oom_kill 6499252\n"
+        "pgmigrate_success 5888075\n"
+        "pgmigrate_fail 236\n"
+        "compact_migrate_scanned 114553\n"
+        "compact_free_scanned 869\n"
+        "compact_isolated 712\n"
+        "compact_stall 9\n"
+        "compact_fail 25\n"
+        "compact_success 6236342\n"
+        "compact_daemon_wake 4996396\n"
+        "compact_daemon_migrate_scanned 859\n"
+        "compact_daemon_free_scanned 4601128\n"
+        "unevictable_pgs_culled 8954670\n"
+        "unevictable_pgs_scanned 9220209\n"
+        "unevictable_pgs_rescued 8032619\n"
+        "unevictable_pgs_mlocked 25\n"
+        "unevictable_pgs_munlocked 602\n"
+        "unevictable_pgs_cleared 999\n"
+        "unevictable_pgs_stranded 9644793\n"
+        "swap_ra 403\n"
+        "swap_ra_hit 859\n"
+        "speculative_pgfault 384\n";
+
+/* 5.10 arm64, split workingset_refault_anon/_file (5.9+), pgscan_anon/_file (5.8+) */
+static const char vmstat_5_10[] =
+        "nr_free_pages 9252992\n"
+        "nr_zone_inactive_anon 7040466\n"
+        "nr_zone_active_anon 110\n"
+        "nr_zone_inactive_file 658\n"
+        "nr_zone_active_file 2645457\n"
+        "nr_zone_unevictable 4618710\n"
+        "nr_zone_write_pending 4047497\n"
+        "nr_mlock 5524290\n"
+        "nr_page_table_pages 231850\n"
+        "nr_bounce 96\n"
+        "nr_zspages 420\n"
+        "nr_free_cma 3652522\n"
+        "nr_inactive_anon 2699561\n"
+        "nr_active_anon 5355236\n"
+        "nr_inactive_file 452197\n"
+        "nr_active_file 186\n"
+        "nr_unevictable 393\n"
+        "nr_slab_reclaimable 2443854\n"
+        "nr_slab_unreclaimable 2021951\n"
+        "nr_isolated_anon 92332\n"
+        "nr_isolated_file 236\n"
+        "workingset_nodes 710\n"
+        "workingset_refault_anon 172\n"
+        "workingset_refault_file 77401\n"
+        "workingset_activate_anon 412734\n"
+        "workingset_activate_file 582\n"
+        "workingset_restore_anon 109\n"
+        "workingset_restore_file 9058365\n"
+        "workingset_nodereclaim 760\n"
+        "nr_anon_pages 978\n"
+        "nr_mapped 2182136\n"
+        "nr_file_pages 219\n"
+        "nr_dirty 2546047\n"
+        "nr_writeback 1707060\n"
+        "nr_writeback_temp 530\n"
+        "nr_shmem 673\n"
+        "nr_shmem_hugepages 9365602\n"
+        "nr_shmem_pmdmapped 3076067\n"
+        "nr_file_hugepages 86\n"
+        "nr_file_pmdmapped 7233256\n"
+        "nr_anon_transparent_hugepages 2115839\n"
+        "nr_vmscan_write 252\n"
+        "nr_vmscan_immediate_reclaim 350\n"
+        "nr_dirtied 121503\n"
+        "nr_written 4972887\n"
+        "nr_kernel_misc_reclaimable 6247699\n"
+        "nr_foll_pin_acquired 1887609\n"
+        "nr_foll_pin_released 1944909\n"
+        "nr_kernel_stack 426\n"
+        "nr_shadow_call_stack 282\n"
+        "nr_dirty_threshold 247\n"
+        "nr_dirty_background_threshold 6639500\n"
+        "pgpgin 2812383\n"
+        "pgpgout 763\n"
+        "pswpin 148\n"
+        "pswpout 2103090\n"
+        "pgalloc_dma32 1673311\n"
+        "pgalloc_normal 171\n"
+        "pgalloc_movable 347\n"
+        "allocstall_dma32 871\n"
+        "allocstall_normal 96\n"
+        "allocstall_movable 6942073\n"
+        "pgskip_dma32 8433036\n"
+        "pgskip_normal 849\n"
+        "pgskip_movable 12\n"
+        "pgfree 1890849\n"
+        "pgactivate 145\n"
+        "pgdeactivate 3360645\n"
+        "pglazyfree 422\n"
+        "pgfault 996\n"
+        "pgmajfault 8326093\n"
+        "pglazyfreed 2237524\n"
+        "pgrefill 4851005\n"
+        "pgreuse 304\n"
+        "pgsteal_kswapd 613\n"
+        "pgsteal_direct 653\n"
+        "pgscan_kswapd 739\n"
+        "pgscan_direct 8062739\n"
+        "pgscan_direct_throttle 2568762\n"
+        "pgscan_anon 299\n"
+        "pgscan_file 967\n"
+        "pgsteal_anon 643\n"
+        "pgsteal_file 373\n"
+        "pginodesteal 2500452\n"
+        "slabs_scanned 790121\n"
+        "kswapd_inodesteal 6226702\n"
+        "kswapd_low_wmark_hit_quickly 91\n"
+        "kswapd_high_wmark_hit_quickly 907\n"
+        "pageoutrun 705\n"
+        "pgrotated 3369216\n"
+        "drop_pagecache 536\n"
+        "drop_slab 3\n"
+        "oom_kill 947\n"
+        "pgmigrate_success 5555050\n"
+        "pgmigrate_fail 771945\n"
+        "thp_migration_success 5861075\n"
+        "thp_migration_fail 1334982\n"
+        "thp_migration_split 6096769\n"
+        "compact_migrate_scanned 4614529\n"
+        "compact_free_scanned 742\n"
+        "compact_isolated 9209186\n"
+        "compact_stall 8647213\n"
+        "compact_fail 408\n"
+        "compact_success 7316099\n"
+        "compact_daemon_wake 538\n"
+        "compact_daemon_migrate_scanned 327415\n"
+        "compact_daemon_free_scanned 695\n"
+        "unevictable_pgs_culled 4346026\n"
+        "unevictable_pgs_scanned 614\n"
+        "unevictable_pgs_rescued 178\n"
+        "unevictable_pgs_mlocked 878\n"
+        "unevictable_pgs_munlocked 200\n"
+        "unevictable_pgs_cleared 1796820\n"
+        "unevictable_pgs_stranded 8518163\n"
+        "swap_ra 805\n"
+        "swap_ra_hit 703\n"
+        "nr_unstable 7472286\n";
+
+/* 6.18 x86-64, pgscan_khugepaged/_proactive before pgscan_direct_throttle */
+static const char vmstat_6_x[] =
+        "nr_free_pages 864341\n"
+        "nr_free_pages_blocks 804864\n"
+        "nr_zone_inactive_anon 55317\n"
+        "nr_zone_active_anon 5\n"
+        "nr_zone_inactive_file 84712\n"
+        "nr_zone_active_file 153804\n"
+        "nr_zone_unevictable 1932\n"
+        "nr_zone_write_pending 62\n"
+        "nr_mlock 1932\n"
+        "nr_zspages 0\n"
+        "nr_free_cma 0\n"
+        "numa_hit 6799898\n"
+        "numa_miss 0\n"
+        "numa_foreign 0\n"
+        "numa_interleave 996\n"
+        "numa_local 6799898\n"
+        "numa_other 0\n"
+        "nr_inactive_anon 55311\n"
+        "nr_active_anon 5\n"
+        "nr_inactive_file 84712\n"
+        "nr_active_file 153804\n"
+        "nr_unevictable 1932\n"
+        "nr_slab_reclaimable 28315\n"
+        "nr_slab_unreclaimable 5644\n"
+        "nr_isolated_anon 0\n"
+        "nr_isolated_file 0\n"
+        "workingset_nodes 0\n"
+        "workingset_refault_anon 0\n"
+        "workingset_refault_file 0\n"
+        "workingset_activate_anon 0\n"
+        "workingset_activate_file 0\n"
+        "workingset_restore_anon 0\n"
+        "workingset_restore_file 0\n"
+        "workingset_nodereclaim 0\n"
+        "nr_anon_pages 55002\n"
+        "nr_mapped 38137\n"
+        "nr_file_pages 240779\n"
+        "nr_dirty 62\n"
+        "nr_writeback 0\n"
+        "nr_shmem 2262\n"
+        "nr_shmem_hugepages 0\n"
+        "nr_shmem_pmdmapped 0\n"
+        "nr_file_hugepages 0\n"
+        "nr_file_pmdmapped 0\n"
+        "nr_anon_transparent_hugepages 0\n"
+        "nr_vmscan_write 0\n"
+        "nr_vmscan_immediate_reclaim 0\n"
+        "nr_dirtied 71169\n"
+        "nr_written 61601\n"
+        "nr_throttled_written 0\n"
+        "nr_kernel_misc_reclaimable 0\n"
+        "nr_foll_pin_acquired 0\n"
+        "nr_foll_pin_released 0\n"
+        "nr_kernel_stack 1104\n"
+        "nr_page_table_pages 501\n"
+        "nr_sec_page_table_pages 0\n"
+        "nr_iommu_pages 0\n"
+        "nr_swapcached 0\n"
+        "pgpromote_success 0\n"
+        "pgpromote_candidate 0\n"
+        "pgpromote_candidate_nrl 0\n"
+        "pgdemote_kswapd 0\n"
+        "pgdemote_direct 0\n"
+        "pgdemote_khugepaged 0\n"
+        "pgdemote_proactive 0\n"
+        "nr_hugetlb 0\n"
+        "nr_balloon_pages 0\n"
+        "nr_kernel_file_pages 0\n"
+        "nr_dirty_threshold 280885\n"
+        "nr_dirty_background_threshold 140271\n"
+        "nr_memmap_pages 0\n"
+        "nr_memmap_boot_pages 24576\n"
+        "pgpgin 1106494\n"
+        "pgpgout 246228\n"
+        "pswpin 0\n"
+        "pswpout 0\n"
+        "pgalloc_dma 0\n"
+        "pgalloc_dma32 0\n"
+        "pgalloc_normal 6880473\n"
+        "pgalloc_movable 0\n"
+        "pgalloc_device 0\n"
+        "allocstall_dma 0\n"
+        "allocstall_dma32 0\n"
+        "allocstall_normal 0\n"
+        "allocstall_movable 0\n"
+        "allocstall_device 0\n"
+        "pgskip_dma 0\n"
+        "pgskip_dma32 0\n"
+        "pgskip_normal 0\n"
+        "pgskip_movable 0\n"
+        "pgskip_device 0\n"
+        "pgfree 7750614\n"
+        "pgactivate 85120\n"
+        "pgdeactivate 3\n"
+        "pglazyfree 0\n"
+        "pgfault 7537304\n"
+        "pgmajfault 334\n"
+        "pglazyfreed 0\n"
+        "pgrefill 0\n"
+        "pgreuse 605037\n"
+        "pgsteal_kswapd 0\n"
+        "pgsteal_direct 0\n"
+        "pgsteal_khugepaged 0\n"
+        "pgsteal_proactive 0\n"
+        "pgscan_kswapd 0\n"
+        "pgscan_direct 0\n"
+        "pgscan_khugepaged 0\n"
+        "pgscan_proactive 0\n"
+        "pgscan_direct_throttle 0\n"
+        "pgscan_anon 0\n"
+        "pgscan_file 0\n"
+        "pgsteal_anon 0\n"
+        "pgsteal_file 0\n"
+        "zone_reclaim_success 0\n"
+        "zone_reclaim_failed 0\n"
+        "pginodesteal 0\n"
+        "slabs_scanned 98\n"
+        "kswapd_inodesteal 0\n"
+        "kswapd_low_wmark_hit_quickly 0\n"
+        "kswapd_high_wmark_hit_quickly 0\n"
+        "pageoutrun 0\n"
+        "pgrotated 80\n"
+        "drop_pagecache 2\n"
+        "drop_slab 2\n"
+        "oom_kill 0\n"
+        "numa_pte_updates 0\n"
+        "numa_huge_pte_updates 0\n"
+        "numa_hint_faults 0\n"
+        "numa_hint_faults_local 0\n"
+        "numa_pages_migrated 0\n"
+        "pgmigrate_success 0\n"
+        "pgmigrate_fail 0\n"
+        "thp_migration_success 0\n"
+        "thp_migration_fail 0\n"
+        "thp_migration_split 0\n"
+        "compact_migrate_scanned 0\n"
+        "compact_free_scanned 0\n"
+        "compact_isolated 0\n"
+        "compact_stall 0\n"
+        "compact_fail 0\n"
+        "compact_success 0\n"
+        "compact_daemon_wake 0\n"
+        "compact_daemon_migrate_scanned 0\n"
+        "compact_daemon_free_scanned 0\n"
+        "htlb_buddy_alloc_success 0\n"
+        "htlb_buddy_alloc_fail 0\n"
+        "unevictable_pgs_culled 62088\n"
+        "unevictable_pgs_scanned 0\n"
+        "unevictable_pgs_rescued 60158\n"
+        "unevictable_pgs_mlocked 62088\n"
+        "unevictable_pgs_munlocked 60158\n"
+        "unevictable_pgs_cleared 0\n"
+        "unevictable_pgs_stranded 0\n"
+        "thp_fault_alloc 0\n"
+        "thp_fault_fallback 0\n"
+        "thp_fault_fallback_charge 0\n"
+        "thp_collapse_alloc 0\n"
+        "thp_collapse_alloc_failed 0\n"
+        "thp_file_alloc 0\n"
+        "thp_file_fallback 0\n"
+        "thp_file_fallback_charge 0\n"
+        "thp_file_mapped 0\n"
+        "thp_split_page 0\n"
+        "thp_split_page_failed 0\n"
+        "thp_deferred_split_page 0\n"
+        "thp_underused_split_page 0\n"
+        "thp_split_pmd 0\n"
+        "thp_scan_exceed_none_pte 0\n"
+        "thp_scan_exceed_swap_pte 0\n"
+        "thp_scan_exceed_share_pte 0\n"
+        "thp_split_pud 0\n"
+        "thp_zero_page_alloc 0\n"
+        "thp_zero_page_alloc_failed 0\n"
+        "thp_swpout 0\n"
+        "thp_swpout_fallback 0\n"
+        "balloon_inflate 0\n"
+        "balloon_deflate 0\n"
+        "balloon_migrate 0\n"
+        "swap_ra 0\n"
+        "swap_ra_hit 0\n"
+        "swpin_zero 0\n"
+        "swpout_zero 0\n"
+        "ksm_swpin_copy 0\n"
+        "cow_ksm 0\n"
+        "zswpin 0\n"
+        "zswpout 0\n"
+        "zswpwb 0\n"
+        "direct_map_level2_splits 0\n"
+        "direct_map_level3_splits 0\n"
+        "direct_map_level2_collapses 0\n"
+        "direct_map_level3_collapses 0\n"
+        "nr_unstable 0\n";